@@ -0,0 +1,470 @@
+// Standard libraries
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+
+// Command line parser
+#include <CLI11.hpp>
+
+// Local headers
+#include <database.hpp>
+#include <exceptions.hpp>
+#include <generator.hpp>
+#include <scoring.hpp>
+#include <timestamp.hpp>
+#include <write_queue.hpp>
+
+using std::string;
+using std::vector;
+using clock_type = std::chrono::steady_clock;
+
+namespace
+{
+	struct method_result
+	{
+		string method;
+		std::size_t ops;
+		double total_seconds;
+		double mean_us;
+		double p50_us;
+		double p99_us;
+		double max_us;
+		std::size_t rows;
+	};
+
+	double elapsed_us(clock_type::time_point start, clock_type::time_point end)
+	{
+		return std::chrono::duration<double, std::micro>(end - start).count();
+	}
+
+	/** Nearest-rank percentile of the (unsorted) latencies */
+	double percentile(vector<double>& latencies, double pct)
+	{
+		if(latencies.empty())
+			return 0;
+		auto rank = static_cast<std::size_t>(pct / 100 * static_cast<double>(latencies.size()));
+		rank = std::min(rank, latencies.size() - 1);
+		std::nth_element(latencies.begin(), latencies.begin() + static_cast<long>(rank),
+				latencies.end());
+		return latencies[rank];
+	}
+
+	/**
+	 * Summarizes the 'latencies' of a method.
+	 * @param total_seconds the time the calls took, which is the sum of the latencies
+	 * unless they overlap
+	 */
+	method_result summarize(const string& method, vector<double>& latencies,
+			std::size_t rows, double total_seconds)
+	{
+		const std::size_t ops = latencies.size();
+		method_result result{method, ops, total_seconds, 0, 0, 0, 0, rows};
+		double latency_sum = 0;
+		for(double latency : latencies)
+		{
+			latency_sum += latency;
+			result.max_us = std::max(result.max_us, latency);
+		}
+		result.mean_us = ops ? latency_sum / static_cast<double>(ops) : 0;
+		result.p50_us = percentile(latencies, 50);
+		result.p99_us = percentile(latencies, 99);
+		return result;
+	}
+
+	/**
+	 * Calls 'op' with every index in [0, ops) timing each call individually.
+	 * 'op' returns the number of rows it affected or retrieved.
+	 */
+	method_result time_method(const string& method, std::size_t ops,
+			const std::function<std::size_t(std::size_t)>& op)
+	{
+		std::cerr << "Timing " << method << " (" << ops << " ops)...\n";
+
+		vector<double> latencies;
+		latencies.reserve(ops);
+		std::size_t rows = 0;
+		double total_seconds = 0;
+
+		for(std::size_t i = 0; i < ops; ++i)
+		{
+			auto start = clock_type::now();
+			rows += op(i);
+			latencies.push_back(elapsed_us(start, clock_type::now()));
+			total_seconds += latencies.back() / 1e6;
+		}
+
+		return summarize(method, latencies, rows, total_seconds);
+	}
+
+	/**
+	 * Enqueues the writes of 'op' for every index in [0, ops) on a write_queue all
+	 * at once, as concurrent clients would. The latency of each write runs from its
+	 * enqueueing until its future is ready.
+	 */
+	method_result time_queued(const string& method, std::size_t ops, const database& db,
+			const std::function<std::future<int>(write_queue&, std::size_t)>& op)
+	{
+		std::cerr << "Timing " << method << " (" << ops << " ops)...\n";
+
+		vector<double> latencies;
+		latencies.reserve(ops);
+		vector<clock_type::time_point> starts;
+		starts.reserve(ops);
+		vector<std::future<int>> futures;
+		futures.reserve(ops);
+		std::size_t rows = 0;
+
+		auto start = clock_type::now();
+		{
+			write_queue queue(db);
+			for(std::size_t i = 0; i < ops; ++i)
+			{
+				starts.push_back(clock_type::now());
+				futures.push_back(op(queue, i));
+			}
+			for(std::size_t i = 0; i < ops; ++i)
+			{
+				rows += static_cast<std::size_t>(futures[i].get());
+				latencies.push_back(elapsed_us(starts[i], clock_type::now()));
+			}
+		}
+		double total_seconds = elapsed_us(start, clock_type::now()) / 1e6;
+
+		return summarize(method, latencies, rows, total_seconds);
+	}
+
+	void print_json(std::ostream& out, const string& engine, std::size_t politicians,
+			std::size_t ratings, std::size_t parties, double populate_seconds,
+			const vector<method_result>& results)
+	{
+		const double populated_rows = static_cast<double>(politicians + ratings);
+
+		out << "{\n"
+		       "  \"engine\": \"" << engine << "\",\n"
+		       "  \"scale\": {\"politicians\": " << politicians
+		    << ", \"ratings\": " << ratings
+		    << ", \"parties\": " << parties << "},\n"
+		       "  \"populate\": {\"seconds\": " << populate_seconds
+		    << ", \"rows_per_second\": "
+		    << (populate_seconds > 0 ? populated_rows / populate_seconds : 0) << "},\n"
+		       "  \"methods\": {";
+
+		for(std::size_t i = 0; i < results.size(); ++i)
+		{
+			const method_result& r = results[i];
+			out << (i ? "," : "") << "\n    \"" << r.method << "\": {"
+			    << "\"ops\": " << r.ops
+			    << ", \"rows\": " << r.rows
+			    << ", \"mean_us\": " << r.mean_us
+			    << ", \"p50_us\": " << r.p50_us
+			    << ", \"p99_us\": " << r.p99_us
+			    << ", \"max_us\": " << r.max_us
+			    << ", \"ops_per_second\": "
+			    << (r.total_seconds > 0 ? static_cast<double>(r.ops) / r.total_seconds : 0)
+			    << "}";
+		}
+		out << "\n  }\n}\n";
+	}
+
+	bool has_affixes(const string& name, const string& prefix, const string& suffix)
+	{
+		return name.size() > prefix.size() + suffix.size()
+				&& name.compare(0, prefix.size(), prefix) == 0
+				&& name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+	}
+
+	/**
+	 * Removes the database at 'db_file' left by a previous run: the SQLite file and its
+	 * journals, or the files of the log engine's directory (and it, once empty).
+	 * Nothing else is touched, in case '--db' names something else by mistake.
+	 */
+	void remove_database(const string& db_file)
+	{
+		namespace fs = std::filesystem;
+		if(!fs::is_directory(db_file))
+		{
+			for(const char* suffix : {"", "-journal", "-wal", "-shm"})
+				fs::remove(db_file + suffix);
+			return;
+		}
+
+		for(const fs::directory_entry& entry : fs::directory_iterator(db_file))
+		{
+			const string name = entry.path().filename().string();
+			if(name == "LOCK" || has_affixes(name, "segment-", ".log")
+					|| has_affixes(name, "snapshot-", ".snap")
+					|| has_affixes(name, "snapshot-", ".snap.tmp"))
+				fs::remove(entry.path());
+		}
+		std::error_code not_empty;
+		fs::remove(db_file, not_empty);
+	}
+
+	int run(const string& engine, std::size_t politicians, std::size_t ratings_per_politician,
+			std::size_t ops, std::size_t scan_ops, const string& db_file, std::uint64_t seed)
+	{
+		// Always start from an empty database
+		remove_database(db_file);
+
+		std::unique_ptr<storage> store = open_storage(engine, db_file);
+		const storage& db = *store;
+		generator gen(seed);
+
+		std::cerr << "Populating " << politicians << " politicians with "
+		          << ratings_per_politician << " ratings each...\n";
+		auto start = clock_type::now();
+		std::size_t ratings = populate(db, gen, politicians, ratings_per_politician);
+		double populate_seconds = elapsed_us(start, clock_type::now()) / 1e6;
+
+		ops = std::min(ops, politicians);
+		const vector<string>& parties = gen.parties();
+
+		// Existing politicians are sampled with a stride, so that no politician is
+		// used twice by the same method
+		const std::size_t stride = std::max<std::size_t>(1, politicians / ops);
+		auto existing = [&gen, stride](std::size_t i) { return gen.make_politician(i * stride); };
+		// Politicians created, updated and deleted by the write benchmarks
+		auto fresh = [&gen, politicians](std::size_t i) { return gen.make_politician(politicians + i); };
+		auto new_party = [&parties, &fresh](std::size_t i)
+		{
+			const politician p = fresh(i);
+			auto it = std::find(parties.begin(), parties.end(), p.party.str());
+			return parties[static_cast<std::size_t>(it - parties.begin() + 1) % parties.size()];
+		};
+
+		vector<method_result> results;
+
+		results.push_back(time_method("insert_to_politician", ops, [&](std::size_t i)
+		{
+			return static_cast<std::size_t>(db.insert_to_politician(fresh(i)));
+		}));
+
+		results.push_back(time_method("insert_to_ratings", ops, [&](std::size_t i)
+		{
+			return static_cast<std::size_t>(db.insert_to_ratings(gen.make_rating(existing(i))));
+		}));
+
+		// Group commit only applies to the SQLite engine
+		if(const database* sqlite = dynamic_cast<const database*>(&db))
+		{
+			results.push_back(time_queued("write_queue.insert_to_ratings", ops, *sqlite,
+					[&](write_queue& queue, std::size_t i)
+			{
+				return queue.insert_to_ratings(gen.make_rating(existing(i)));
+			}));
+		}
+
+		results.push_back(time_method("update_party", ops, [&](std::size_t i)
+		{
+			const politician p = fresh(i);
+			return static_cast<std::size_t>(
+					db.update_party(politician_update(p.name, p.party, new_party(i))));
+		}));
+
+		results.push_back(time_method("get_politician_by_name", ops, [&](std::size_t i)
+		{
+			return db.get_politician_by_name(existing(i).name).size();
+		}));
+
+		results.push_back(time_method("get_politician_ratings", ops, [&](std::size_t i)
+		{
+			return db.get_politician_ratings(existing(i)).size();
+		}));
+
+		// The same lookup, paying for the snapshot around it
+		results.push_back(time_method("read_snapshot", ops, [&](std::size_t i)
+		{
+			std::size_t rows = 0;
+			db.read_snapshot([&](std::int64_t)
+			{
+				rows = db.get_politician_ratings(existing(i)).size();
+			});
+			return rows;
+		}));
+
+		// A comparison of 50 politicians, fetched by a single call
+		const std::size_t batch_size = 50;
+		auto batch = [&gen, politicians, batch_size](std::size_t i)
+		{
+			vector<politician_core> keys;
+			for(std::size_t j = 0; j < batch_size; ++j)
+			{
+				const politician p = gen.make_politician((i * batch_size + j) % politicians);
+				keys.emplace_back(p.name, p.party);
+			}
+			return keys;
+		};
+		results.push_back(time_method("get_politicians_batch", ops, [&](std::size_t i)
+		{
+			return db.get_politicians_batch(batch(i)).size();
+		}));
+
+		results.push_back(time_method("count_politicians_batch", ops, [&](std::size_t i)
+		{
+			db.count_politicians_batch(batch(i));
+			return std::size_t(1);
+		}));
+
+		results.push_back(time_method("get_ratings_batch", ops, [&](std::size_t i)
+		{
+			std::size_t rows = 0;
+			for(const vector<rating>& ratings : db.get_ratings_batch(batch(i)))
+				rows += ratings.size();
+			return rows;
+		}));
+
+		results.push_back(time_method("get_ratings_in_range", ops, [&](std::size_t i)
+		{
+			// The latest few ratings of a politician
+			rating_range range;
+			range.descending = true;
+			range.limit = 5;
+			return db.get_ratings_in_range(existing(i), range).size();
+		}));
+
+		const std::int64_t now = timestamp::now();
+		const std::int64_t day = 86400 * std::int64_t(1000000);
+		results.push_back(time_method("get_all_ratings_in_range", ops, [&](std::size_t i)
+		{
+			// The latest ratings of a day, a day further back each time
+			rating_range range;
+			range.to = now - static_cast<std::int64_t>(i) * day;
+			range.from = range.to - day;
+			range.descending = true;
+			range.limit = 100;
+			return db.get_all_ratings_in_range(range).size();
+		}));
+
+		results.push_back(time_method("get_politicians_by_party", scan_ops, [&](std::size_t i)
+		{
+			return db.get_politicians_by_party(parties[i % parties.size()]).size();
+		}));
+
+		results.push_back(time_method("count_politicians_by_party", ops, [&](std::size_t i)
+		{
+			db.count_politicians_by_party(parties[i % parties.size()]);
+			return std::size_t(1);
+		}));
+
+		results.push_back(time_method("count_politicians_where", scan_ops, [&](std::size_t i)
+		{
+			db.count_politicians_where(parse_filter("points > " + std::to_string(i)));
+			return std::size_t(1);
+		}));
+
+		results.push_back(time_method("get_all_politicians", scan_ops, [&](std::size_t i)
+		{
+			return db.get_all_politicians(i % 2 ? "ASC" : "DESC").size();
+		}));
+
+		results.push_back(time_method("get_politicians_compact", scan_ops, [&](std::size_t i)
+		{
+			return db.get_politicians_compact(i % 2 ? "ASC" : "DESC").size();
+		}));
+
+		results.push_back(time_method("for_each_politician_with_ratings", scan_ops,
+				[&](std::size_t i)
+		{
+			std::size_t rows = 0;
+			db.for_each_politician_with_ratings(3, i % 2 ? "ASC" : "DESC",
+					[&rows](const politician&, const vector<rating>& ratings)
+			{
+				rows += 1 + ratings.size();
+			});
+			return rows;
+		}));
+
+		results.push_back(time_method("get_politicians_projected", scan_ops, [&](std::size_t i)
+		{
+			return db.get_politicians_projected({politician_field::name, politician_field::points},
+					i % 2 ? "ASC" : "DESC").size();
+		}));
+
+		results.push_back(time_method("get_party_leaderboard", ops, [&](std::size_t i)
+		{
+			return db.get_party_leaderboard(leaderboard_orders()[i % 3], i % 2 ? "ASC" : "DESC")
+				.size();
+		}));
+
+		results.push_back(time_method("get_politician_histogram", ops, [&](std::size_t i)
+		{
+			db.get_politician_histogram(existing(i));
+			return std::size_t(1);
+		}));
+
+		results.push_back(time_method("get_party_histogram", ops, [&](std::size_t i)
+		{
+			db.get_party_histogram(parties[i % parties.size()]);
+			return std::size_t(1);
+		}));
+
+		results.push_back(time_method("get_politician_stats", scan_ops, [&](std::size_t)
+		{
+			return db.get_politician_stats().size();
+		}));
+
+		// Scores every politician on a different mix of features each time
+		const feature_table features(db.get_politician_stats(), timestamp::now());
+		results.push_back(time_method("top_k", ops, [&](std::size_t i)
+		{
+			score_weights weights;
+			weights.mean = static_cast<float>(i % 7);
+			weights.recency = static_cast<float>(i % 5) * 10;
+			weights.negatives = -static_cast<float>(i % 3);
+			return top_k(features, weights, 10).size();
+		}));
+
+		results.push_back(time_method("delete_politician", ops, [&](std::size_t i)
+		{
+			return static_cast<std::size_t>(
+					db.delete_politician(politician_core(fresh(i).name, new_party(i))));
+		}));
+
+		print_json(std::cout, engine, politicians, ratings, parties.size(), populate_seconds, results);
+		return 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::ios_base::sync_with_stdio(false);
+
+	CLI::App app("Benchmark every database operation over a synthetic dataset");
+
+	std::size_t politicians(10000), ratings(5), ops(500), scan_ops(5);
+	std::uint64_t seed(42);
+	string engine(storage_engines().front());
+	string db_file((std::filesystem::temp_directory_path() / "politician-bench.db").string());
+
+	app.add_option("-n,--politicians", politicians, "Number of politicians to generate", true)
+		->check(CLI::Range(1000, 10000000));
+	app.add_option("-r,--ratings", ratings, "Ratings generated for each politician", true);
+	app.add_option("-o,--ops", ops, "Timed calls of each single-row method", true);
+	app.add_option("-s,--scan-ops", scan_ops,
+			"Timed calls of each method that scans many rows", true);
+	app.add_option("--seed", seed, "Seed of the random generator", true);
+	app.add_option("--db", db_file,
+			"Database file or log directory (its database files are overwritten)", true);
+	app.add_option("--engine", engine, "Storage engine", true)
+		->check(CLI::IsMember(storage_engines()));
+
+	CLI11_PARSE(app, argc, argv);
+
+	try
+	{
+		return run(engine, politicians, ratings, ops, scan_ops, db_file, seed);
+	}
+	catch(const db_exception& e)
+	{
+		std::cerr << "Database error: " << e.what() << "\n";
+		return EXIT_FAILURE;
+	}
+	catch(const std::exception& e)
+	{
+		std::cerr << "Error: " << e.what() << "\n";
+		return EXIT_FAILURE;
+	}
+}
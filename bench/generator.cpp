@@ -0,0 +1,170 @@
+// Standard libraries
+#include <algorithm>
+#include <ctime>
+
+// Local headers
+#include <generator.hpp>
+
+using std::string;
+using std::vector;
+using std::move;
+
+namespace
+{
+	const vector<string> first_names = {
+		"ANA", "ANTÔNIO", "BEATRIZ", "BRUNO", "CAMILA", "CARLOS", "CLÁUDIA", "DANIEL",
+		"EDUARDO", "ELIANE", "FÁBIO", "FERNANDA", "FLÁVIO", "GABRIELA", "GERALDO", "GUSTAVO",
+		"HELENA", "HUGO", "ISABEL", "JOÃO", "JOSÉ", "JÚLIA", "LEONARDO", "LÚCIA",
+		"LUIZ", "MARCELO", "MARCOS", "MARIA", "MÁRCIA", "MARINA", "MATEUS", "NATÁLIA",
+		"OTÁVIO", "PAULO", "PATRÍCIA", "PEDRO", "RAFAEL", "RAQUEL", "RENATO", "RICARDO",
+		"ROBERTO", "RODRIGO", "SANDRA", "SÉRGIO", "SIMONE", "TATIANA", "TIAGO", "VALÉRIA",
+		"VINÍCIUS", "VITÓRIA", "WAGNER", "WALTER", "ADRIANA", "ALEXANDRE", "ANDRÉ", "CÉSAR",
+		"DÉBORA", "EMÍLIA", "FRANCISCO", "GILBERTO", "INÊS", "JOAQUIM", "MÔNICA", "SÍLVIA"
+	};
+
+	const vector<string> surnames = {
+		"SILVA", "SANTOS", "OLIVEIRA", "SOUZA", "RODRIGUES", "FERREIRA", "ALVES", "PEREIRA",
+		"LIMA", "GOMES", "COSTA", "RIBEIRO", "MARTINS", "CARVALHO", "ALMEIDA", "LOPES",
+		"SOARES", "FERNANDES", "VIEIRA", "BARBOSA", "ROCHA", "DIAS", "NASCIMENTO", "ANDRADE",
+		"MOREIRA", "NUNES", "MARQUES", "MACHADO", "MENDES", "FREITAS", "CARDOSO", "RAMOS",
+		"GONÇALVES", "SANTANA", "TEIXEIRA", "ARAÚJO", "CAVALCANTI", "MONTEIRO", "MOURA", "CORREIA",
+		"PINTO", "CUNHA", "CASTRO", "CAMPOS", "BATISTA", "FONSECA", "MIRANDA", "MEDEIROS",
+		"BRAGA", "FARIAS", "GUIMARÃES", "PACHECO", "SAMPAIO", "TAVARES", "XAVIER", "BRANDÃO",
+		"PEIXOTO", "QUEIROZ", "REIS", "SALES", "MAGALHÃES", "ASSIS", "VASCONCELOS", "FALCÃO"
+	};
+
+	// Ordered roughly by size, which make_politician relies on to favour larger parties
+	const vector<string> party_names = {
+		"PT", "PL", "UNIÃO", "PP", "MDB", "PSD", "REPUBLICANOS", "PDT",
+		"PSB", "PSDB", "PSOL", "PODEMOS", "AVANTE", "PCDOB", "PV", "CIDADANIA",
+		"SOLIDARIEDADE", "NOVO", "PATRIOTA", "PSC", "PROS", "REDE", "PTB", "AGIR",
+		"DC", "PMB", "PRTB", "PCO", "PSTU", "UP", "NONE"
+	};
+
+	const vector<string> descriptions = {
+		"Voted in favour of the education budget increase.",
+		"Voted against the environmental protection bill.",
+		"Missed the plenary session without justification.",
+		"Proposed a bill to reduce bureaucracy for small businesses.",
+		"Involved in an investigation for misuse of public funds.",
+		"Defended transparency of parliamentary expenses.",
+		"Voted to increase the electoral fund.",
+		"Authored the law extending public health coverage.",
+		"Spread misinformation during the electoral campaign.",
+		"Supported the pension reform.",
+		"Obstructed the vote on the anti-corruption package.",
+		"Returned the housing allowance to the public treasury.",
+		"Voted in favour of the infrastructure investment plan.",
+		"Changed position on the tax reform after lobbying.",
+		"Held public hearings with affected communities.",
+		"N/A"
+	};
+
+	// Rating points [-5, 5] weights, mildly concentrated around small values
+	const vector<double> point_weights = {3, 3, 5, 8, 11, 6, 13, 10, 7, 4, 3};
+
+	/** SplitMix64 finalizer, used to derive deterministic attributes from an index */
+	std::uint64_t mix(std::uint64_t x)
+	{
+		x += 0x9E3779B97F4A7C15ULL;
+		x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+		return x ^ (x >> 31);
+	}
+
+	string roman(std::size_t n)
+	{
+		static const std::pair<std::size_t, const char*> numerals[] = {
+			{1000, "M"}, {900, "CM"}, {500, "D"}, {400, "CD"}, {100, "C"}, {90, "XC"},
+			{50, "L"}, {40, "XL"}, {10, "X"}, {9, "IX"}, {5, "V"}, {4, "IV"}, {1, "I"}
+		};
+		string result;
+		for(const auto& [value, symbol] : numerals)
+			for(; n >= value; n -= value)
+				result += symbol;
+		return result;
+	}
+}
+
+generator::generator(std::uint64_t seed)
+	: rng(seed)
+{}
+
+const vector<string>& generator::parties() const
+{
+	return party_names;
+}
+
+politician generator::make_politician(std::size_t index) const
+{
+	const std::uint64_t hash = mix(index);
+
+	string name = first_names[index % first_names.size()];
+	std::size_t rest = index / first_names.size();
+	name += ' ' + surnames[rest % surnames.size()];
+	rest /= surnames.size();
+	name += ' ' + surnames[rest % surnames.size()];
+	rest /= surnames.size();
+	// Once every combination was used, homonyms are told apart by a generational suffix
+	if(rest > 0)
+		name += ' ' + roman(rest + 1);
+
+	// The minimum of two uniform picks favours the first (larger) parties
+	std::size_t party = std::min(hash % party_names.size(),
+			(hash >> 32) % party_names.size());
+
+	string info = "Synthetic politician #" + std::to_string(index);
+
+	return politician(move(name), party_names[party], move(info));
+}
+
+rating generator::make_rating(const politician_core& p, std::int64_t date_time)
+{
+	std::discrete_distribution<int> points(point_weights.begin(), point_weights.end());
+	std::uniform_int_distribution<std::size_t> description(0, descriptions.size() - 1);
+
+	return rating(p.name, p.party, descriptions[description(rng)],
+			static_cast<short>(points(rng) - 5), date_time);
+}
+
+vector<std::int64_t> generator::make_date_times(std::size_t count)
+{
+	// Four years worth of microseconds
+	const std::int64_t span = 4LL * 365 * 24 * 60 * 60 * 1000000;
+	const std::int64_t step = std::max<std::int64_t>(
+			1, span / static_cast<std::int64_t>(std::max<std::size_t>(count, 1)));
+
+	std::uniform_int_distribution<std::int64_t> offset(0, span);
+	std::uniform_int_distribution<std::int64_t> gap(1, step);
+
+	std::int64_t current = static_cast<std::int64_t>(std::time(nullptr)) * 1000000
+		- span - offset(rng) / 2;
+
+	vector<std::int64_t> date_times;
+	date_times.reserve(count);
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		current += gap(rng);
+		date_times.push_back(current);
+	}
+	return date_times;
+}
+
+std::size_t populate(const storage& db, generator& gen, std::size_t politicians,
+		std::size_t ratings_per_politician)
+{
+	std::size_t inserted = 0;
+	db.bulk_load([&db, &gen, politicians, ratings_per_politician, &inserted]
+	{
+		for(std::size_t i = 0; i < politicians; ++i)
+		{
+			const politician p = gen.make_politician(i);
+			db.insert_to_politician(p);
+
+			for(std::int64_t date_time : gen.make_date_times(ratings_per_politician))
+				inserted += static_cast<std::size_t>(
+						db.insert_to_ratings(gen.make_rating(p, date_time)));
+		}
+	});
+	return inserted;
+}
@@ -0,0 +1,60 @@
+#ifndef GENERATOR_HPP
+#define GENERATOR_HPP
+
+// Standard libraries
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+// Local headers
+#include <politician.hpp>
+#include <storage.hpp>
+
+using std::string;
+using std::vector;
+
+/**
+ * Generates synthetic, but realistic looking, politicians, parties and ratings.
+ * Politicians are derived from an index, so the same index always produces the
+ * same (unique) name and party, while ratings are drawn from a seeded PRNG.
+ */
+struct generator
+{
+	std::mt19937_64 rng;
+
+	/** Constructor */
+	explicit generator(std::uint64_t seed);
+
+	/** All the parties politicians may belong to */
+	const vector<string>& parties() const;
+
+	/**
+	 * Builds the politician identified by 'index'.
+	 * Different indexes always produce different names.
+	 */
+	politician make_politician(std::size_t index) const;
+
+	/**
+	 * Builds a random rating for politician 'p'.
+	 * @param date_time the timestamp of the rating, 0 to let the database fill
+	 * it in.
+	 */
+	rating make_rating(const politician_core& p, std::int64_t date_time = 0);
+
+	/**
+	 * Generates 'count' distinct, ascending timestamps (microseconds since the
+	 * epoch) spread over the last few years.
+	 */
+	vector<std::int64_t> make_date_times(std::size_t count);
+};
+
+/**
+ * Fills the (empty) storage 'db' with 'politicians' politicians and
+ * 'ratings_per_politician' ratings for each one of them, in a single bulk load.
+ * @return the number of ratings inserted
+ */
+std::size_t populate(const storage& db, generator& gen, std::size_t politicians,
+		std::size_t ratings_per_politician);
+
+#endif
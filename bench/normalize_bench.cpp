@@ -0,0 +1,95 @@
+// Standard libraries
+#include <chrono>
+#include <iostream>
+
+// External libraries
+#include <boost/locale.hpp>
+
+// Command line parser
+#include <CLI11.hpp>
+
+// Local headers
+#include <generator.hpp>
+#include <normalize.hpp>
+
+using std::string;
+using std::vector;
+using clock_type = std::chrono::steady_clock;
+
+namespace
+{
+	/**
+	 * Converts every input 'rounds' times with 'convert'.
+	 * @return the mean nanoseconds per conversion
+	 */
+	template<class Convert>
+	double time_conversion(const vector<string>& inputs, std::size_t rounds, Convert convert)
+	{
+		std::size_t checksum = 0;
+		auto start = clock_type::now();
+		for(std::size_t round = 0; round < rounds; ++round)
+			for(const string& input : inputs)
+				checksum += convert(input).size();
+		auto end = clock_type::now();
+
+		// Keeps the conversions from being optimised away
+		if(checksum == 0)
+			std::cerr << "Empty conversions\n";
+
+		return std::chrono::duration<double, std::nano>(end - start).count()
+			/ static_cast<double>(rounds * inputs.size());
+	}
+
+	void print_case(const string& name, const vector<string>& inputs, std::size_t rounds,
+			bool last)
+	{
+		double boost_ns = time_conversion(inputs, rounds, [](const string& s)
+		{
+			return boost::locale::to_upper(s, user_locale());
+		});
+		double fast_ns = time_conversion(inputs, rounds, [](const string& s)
+		{
+			return to_upper(s);
+		});
+
+		std::cout << "    \"" << name << "\": {\"inputs\": " << inputs.size()
+		          << ", \"boost_ns\": " << boost_ns
+		          << ", \"to_upper_ns\": " << fast_ns
+		          << ", \"speedup\": " << boost_ns / fast_ns << "}"
+		          << (last ? "\n" : ",\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::ios_base::sync_with_stdio(false);
+
+	CLI::App app("Compare to_upper with boost::locale::to_upper on generated names");
+
+	std::size_t names(10000), rounds(20);
+	app.add_option("-n,--names", names, "Number of generated names", true);
+	app.add_option("-r,--rounds", rounds, "Conversions of each name", true);
+
+	CLI11_PARSE(app, argc, argv);
+
+	// The generated names are uppercase, so they're converted back to lowercase to
+	// give to_upper some work
+	generator gen(42);
+	vector<string> ascii, accented, mixed;
+	for(std::size_t i = 0; mixed.size() < names; ++i)
+	{
+		politician p = gen.make_politician(i);
+		string lower = boost::locale::to_lower(p.name + " " + p.party.str(), user_locale());
+		if(is_ascii(lower) && ascii.size() < names)
+			ascii.push_back(lower);
+		else if(!is_ascii(lower) && accented.size() < names)
+			accented.push_back(lower);
+		mixed.push_back(move(lower));
+	}
+
+	std::cout << "{\n  \"to_upper\": {\n";
+	print_case("ascii", ascii, rounds, false);
+	print_case("accented", accented, rounds, false);
+	print_case("mixed", mixed, rounds, true);
+	std::cout << "  }\n}\n";
+}
@@ -2,6 +2,9 @@
 #define DATA_BASE_HPP
 
 // Standard libraries
+#include <chrono>
+#include <random>
+#include <unordered_map>
 #include <vector>
 
 // External libraries
@@ -9,14 +12,46 @@
 
 // Local headers
 #include <politician.hpp>
+#include <storage.hpp>
 
 using std::string;
 using std::vector;
 
-struct database
+/**
+ * How a connection waits for a lock held by another connection (another process
+ * rating at the same time, for instance): it retries after an exponential
+ * backoff, drawn at random from the upper half of the backoff so that the
+ * waiters don't retry in lockstep, until 'timeout' has gone by.
+ */
+struct busy_policy
+{
+	// Backoff before the first retry, doubled by every retry up to 'max_backoff'
+	std::chrono::microseconds initial_backoff{1000};
+	std::chrono::microseconds max_backoff{100000};
+
+	// Total wait after which the operation fails with SQLITE_BUSY, 0 to fail at once
+	std::chrono::milliseconds timeout{5000};
+};
+
+/**
+ * The SQLite storage engine, the default one.
+ */
+struct database : storage
 {
 	sqlite3* connection;
 
+	// Prepared statements of the static queries, kept for reuse by their SQL text
+	mutable std::unordered_map<const char*, sqlite3_stmt*> statement_cache;
+
+	// When the connection started waiting for the lock it's waiting for
+	mutable std::chrono::steady_clock::time_point busy_since;
+
+	// Random source of the backoff jitter
+	mutable std::minstd_rand busy_jitter;
+
+	// Busy handling of the connections opened from now on
+	static busy_policy busy;
+
 	// Name of the database file
 	static const string DB_FILE;
 
@@ -29,53 +64,115 @@ struct database
 	 */
 	database();
 
+	/**
+	 * Class constructor.
+	 * Same as the default constructor, but uses the database file at 'db_file'
+	 * instead of the one inside the user's HOME dir.
+	 */
+	explicit database(const string& db_file);
+
 	/**
 	 * Class destructor.
-	 * Close the database connection.
+	 * Finalize the cached statements and close the database connection.
+	 */
+	~database() override;
+
+	/**
+	 * Reads the version of the schema stored in the database file.
+	 * @return the schema version, 0 for a new database file
+	 */
+	int get_schema_version() const;
+
+	/**
+	 * Brings the schema of the database file up to date by applying every missing
+	 * migration inside a single transaction. Does nothing if it's already up to date.
+	 */
+	void update_schema() const;
+
+	/**
+	 * Checks that no two politicians of the same party have names that only differ
+	 * by accents or case, which the lookup keys of add_lookup_keys can't
+	 * tell apart. Throws a db_exception listing them otherwise.
 	 */
-	~database();
+	void check_lookup_keys() const;
+
+	/**
+	 * Executes the SQL statements in 'sql', throwing a db_exception on error.
+	 * @param operation the operation being performed, used in the error message
+	 * @param function_name the calling function, used in the error message
+	 */
+	void execute(const char* sql, const string& operation,
+			const string& function_name) const;
+
+	/**
+	 * Retrieves the id of 'party', inserting the party first if it doesn't exist
+	 * and 'create' is set.
+	 * @return the id of the party, 0 if it doesn't exist and wasn't created
+	 */
+	sqlite3_int64 get_party_id(const party_handle& party, bool create) const;
 
 	/**
 	 * Inserts a new politician to the database.
 	 * @return the number of affected rows
 	 */
-	int insert_to_politician(const politician& p) const;
+	int insert_to_politician(const politician& p) const override;
 
 	/**
 	 * Inserts a new rating to the database.
 	 * @return the number of affected rows
 	 */
-	int insert_to_ratings(const rating& r) const;
+	int insert_to_ratings(const rating& r) const override;
 
 	/**
 	 * Update the party of a politician.
 	 * @return the number of affected rows
 	 */
-	int update_party(const politician_update& p) const;
+	int update_party(const politician_update& p) const override;
 
 	/**
 	 * Delete a politician from the database.
 	 * @return the number of affected rows
 	 */
-	int delete_politician(const politician_core& p) const;
+	int delete_politician(const politician_core& p) const override;
 
 	/**
 	 * Retrives all politician which matches the 'name'.
 	 * @return a vector of all politicians retrieved.
 	 */
-	const vector<politician> get_politician_by_name(const string& name) const;
+	const vector<politician> get_politician_by_name(const string& name) const override;
 
 	/**
 	 * Retrives all politicians belonging to a party.
 	 * @return a vector of all politicians belonging to party.
 	 */
-	const vector<politician> get_politicians_by_party(const string& party) const;
+	const vector<politician> get_politicians_by_party(const string& party) const override;
 
 	/**
-	 * Retrives all the ratings belonging to a politician.
+	 * Retrives all the ratings belonging to a politician, oldest first.
 	 * @return a vector of all ratings belonging to politician.
 	 */
-	const vector<rating> get_politician_ratings(const politician_core& p) const;
+	const vector<rating> get_politician_ratings(const politician_core& p) const override;
+
+	/**
+	 * The keys are bound as a single JSON array, which the statement reads with
+	 * json_each, so any number of keys is looked up by one cached statement.
+	 */
+	const vector<std::optional<politician>> get_politicians_batch(
+			const vector<politician_core>& keys) const override;
+
+	/** Reads the ratings of every key with one statement, as the function above */
+	const vector<vector<rating>> get_ratings_batch(
+			const vector<politician_core>& keys) const override;
+
+	/**
+	 * Reads the range of the primary key of ratings, (politician_id, date_time),
+	 * in either direction.
+	 */
+	const vector<rating> get_ratings_in_range(const politician_core& p,
+			const rating_range& range) const override;
+
+	/** Reads the range of the index of ratings on date_time, in either direction */
+	const vector<rating> get_all_ratings_in_range(const rating_range& range) const override;
 
 	/**
 	 * Retrives all politicians registered in the database.
@@ -83,7 +180,7 @@ struct database
 	 * based on the ratings points ("DESC" or "ASC").
 	 * @return a vector of all politicians registered in the database.
 	 */
-	const vector<politician> get_all_politicians(const string& order = "DESC") const;
+	const vector<politician> get_all_politicians(const string& order = "DESC") const override;
 
 	/**
 	 * Compact version of function 'get_all_politicians'.
@@ -93,7 +190,98 @@ struct database
 	 * @return a vector of all politician's names and parties registered in the database.
 	 */
 	const vector<politician_core> get_politicians_compact(
-			const string& order = "DESC") const;
+			const string& order = "DESC") const override;
+
+	/**
+	 * A single query joins each politician with the range of the primary key of
+	 * ratings holding its latest ratings, found by a correlated subquery, so only
+	 * those ratings are read. Its rows are grouped by politician as they're stepped.
+	 * No index has the order of get_all_politicians (the party name breaks ties), so
+	 * SQLite sorts every row before returning the first one.
+	 */
+	void for_each_politician_with_ratings(std::size_t latest, const string& order,
+			const politician_visitor& visit) const override;
+
+	/**
+	 * The SELECT list is built from the 'fields', so that the columns of the other
+	 * fields are neither read nor decoded.
+	 */
+	const vector<projected_politician> get_politicians_projected(
+			const vector<politician_field>& fields, const string& order = "DESC") const override;
+
+	/**
+	 * The filter is compiled to the WHERE clause of a single query, its values
+	 * bound as parameters, so that SQLite filters using its indexes.
+	 */
+	const vector<politician> get_politicians_where(
+			const filter_expression& filter) const override;
+
+	/** Runs a COUNT(*) query over the index on name_key, or an EXISTS one */
+	std::int64_t count_politicians_by_name(const string& name,
+			bool exists = false) const override;
+
+	/** Reads the member count maintained in the party table */
+	std::int64_t count_politicians_by_party(const string& party,
+			bool exists = false) const override;
+
+	/**
+	 * Counts the range of the primary key of ratings, up to the limit of 'range',
+	 * or 1 if 'exists' is set.
+	 */
+	std::int64_t count_ratings_in_range(const politician_core& p,
+			const rating_range& range, bool exists = false) const override;
+
+	/** Counts the range of the index of ratings on date_time, as the function above */
+	std::int64_t count_all_ratings_in_range(const rating_range& range,
+			bool exists = false) const override;
+
+	/** Runs a COUNT(*) query, or an EXISTS one */
+	std::int64_t count_politicians(bool exists = false) const override;
+
+	/** The filter is compiled to the WHERE clause of a COUNT(*) or EXISTS query */
+	std::int64_t count_politicians_where(const filter_expression& filter,
+			bool exists = false) const override;
+
+	/** Runs the join of get_politicians_batch as a COUNT(*) query, or an EXISTS one */
+	std::int64_t count_politicians_batch(const vector<politician_core>& keys,
+			bool exists = false) const override;
+
+	/** Runs a COUNT(*) query over the party table, or an EXISTS one */
+	std::int64_t count_parties(bool exists = false) const override;
+
+	/**
+	 * Only reads the party table, whose aggregates are maintained by triggers on
+	 * the politician table.
+	 */
+	const vector<party_summary> get_party_leaderboard(const string& by = "total",
+			const string& order = "DESC") const override;
+
+	/** Reads the politician_histogram table, maintained by triggers on ratings */
+	rating_histogram get_politician_histogram(const politician_core& p) const override;
+
+	/** Reads the party_histogram table, maintained by triggers on ratings */
+	rating_histogram get_party_histogram(const string& party) const override;
+
+	/**
+	 * The counts come from politician_histogram, the latest rating from the
+	 * primary key of ratings.
+	 */
+	vector<politician_stats> get_politician_stats() const override;
+
+	/** Runs 'load' inside a db_bulk_load */
+	void bulk_load(const std::function<void()>& load) const override;
+
+	/** Runs 'read' inside a db_snapshot */
+	void read_snapshot(const std::function<void(std::int64_t)>& read) const override;
+
+	/**
+	 * The politicians are split into 'threads' ranges of ids, each one checked by
+	 * a worker thread over its own read-only connection, which also returns the share
+	 * of its range in the actual aggregates of each party. Those are added up and
+	 * compared with the stored ones afterwards. Other connections can't write to the
+	 * database meanwhile.
+	 */
+	verify_report verify_totals(unsigned threads, bool fix) const override;
 };
 
 struct sqlite_stmt_obj
@@ -102,23 +290,205 @@ struct sqlite_stmt_obj
 
 	const string& function_name;
 
+	// The database whose statement cache the statement returns to, if any
+	const database* cache;
+
+	const char* query;
+
 	/**
 	 * Class constructor.
 	 * Initialize the prepare statement with the provided SQL query.
 	 */
 	sqlite_stmt_obj(sqlite3* connection, const char* query, const string& function_name);
 
+	/**
+	 * Class constructor.
+	 * Takes the statement of 'query' from the statement cache of 'db', only
+	 * preparing it if it isn't there. 'query' must be a static string.
+	 */
+	sqlite_stmt_obj(const database& db, const char* query, const string& function_name);
+
 	/**
 	 * Class destructor.
-	 * Finalize the statement object.
+	 * Finalize the statement object, or reset it and give it back to the cache.
 	 */
 	~sqlite_stmt_obj();
 };
 
+struct db_transaction
+{
+	const database& db;
+
+	// Whether the transaction still needs to be committed or rolled back
+	bool open;
+
+	// Whether it's a savepoint nested in a transaction that was already open
+	bool nested;
+
+	/**
+	 * Class constructor.
+	 * Begins a transaction with the statement 'begin' ("BEGIN;", "BEGIN IMMEDIATE;" etc).
+	 * Inside an open transaction a savepoint is used instead, so that the
+	 * operations using db_transaction can also run as part of a larger one.
+	 */
+	explicit db_transaction(const database& db, const char* begin = "BEGIN;");
+
+	/** Commits the transaction */
+	void commit();
+
+	/**
+	 * Class destructor.
+	 * Rolls the transaction back if it wasn't committed.
+	 */
+	~db_transaction();
+};
+
+/**
+ * A transaction for bulk loads of ratings. The aggregates of the politicians
+ * (total_rating, histograms etc) aren't updated by every inserted rating. The
+ * politicians whose ratings changed are recorded instead, and only their
+ * aggregates, and those of their parties, are recomputed from their ratings when
+ * the bulk load is committed.
+ * Other connections keep updating the aggregates row by row.
+ */
+struct db_bulk_load
+{
+	db_transaction transaction;
+
+	/**
+	 * Class constructor.
+	 * Begins the transaction and suspends the per-rating maintenance of aggregates.
+	 */
+	explicit db_bulk_load(const database& db);
+
+	/** Applies the accumulated changes to the aggregates and commits */
+	void commit();
+};
+
+/**
+ * A read transaction over a snapshot of the database. The snapshot is taken by
+ * the first read, that of the data version, and the later reads of the
+ * transaction keep seeing it: in WAL mode the commits of other connections go on
+ * meanwhile, but aren't visible until the transaction ends.
+ */
+struct db_snapshot
+{
+	db_transaction transaction;
+
+	// Data version of the snapshot
+	std::int64_t data_version;
+
+	/**
+	 * Class constructor.
+	 * Begins the transaction and takes the snapshot.
+	 */
+	explicit db_snapshot(const database& db);
+};
+
 namespace sql_strings
 {
+	extern const char* configure_connection;
+
+	extern const char* get_schema_version;
+
+	extern const char* check_foreign_keys;
+
 	extern const char* create_tables;
 
+	extern const char* add_lookup_keys;
+
+	extern const char* lookup_key_collisions;
+
+	extern const char* create_party_table;
+
+	extern const char* add_politician_id;
+
+	extern const char* integer_timestamps;
+
+	extern const char* defer_aggregates;
+
+	extern const char* maintain_totals;
+
+	extern const char* party_aggregates;
+
+	extern const char* rating_histograms;
+
+	extern const char* index_rating_dates;
+
+	extern const char* data_version;
+
+	extern const char* track_bulk_loads;
+
+	// Statements upgrading the schema from version N to N + 1, stored at index N
+	extern const char* const migrations[];
+
+	// The schema version of the database file after every migration is applied
+	extern const int schema_version;
+
+	extern const char* begin_bulk_load;
+
+	extern const char* finish_bulk_load;
+
+	extern const char* get_data_version;
+
+	extern const char* politician_id_range;
+
+	extern const char* verify_politicians;
+
+	extern const char* verify_party_aggregates;
+
+	extern const char* verify_party_histograms;
+
+	extern const char* fix_total;
+
+	extern const char* fix_politician_histogram;
+
+	extern const char* fix_member_count;
+
+	extern const char* fix_party_total;
+
+	extern const char* fix_party_histogram;
+
+	extern const char* search_where;
+
+	extern const char* count_by_name;
+
+	extern const char* exists_by_name;
+
+	extern const char* count_by_party;
+
+	extern const char* count_ratings_in_range;
+
+	extern const char* count_all_ratings_in_range;
+
+	extern const char* count_politicians;
+
+	extern const char* exists_politicians;
+
+	extern const char* count_where;
+
+	extern const char* exists_where;
+
+	extern const char* count_politicians_batch;
+
+	extern const char* exists_politicians_batch;
+
+	extern const char* count_parties;
+
+	extern const char* exists_parties;
+
+	extern const char* show_parties;
+
+	extern const char* politician_histogram;
+
+	extern const char* party_histogram;
+
+	extern const char* politician_stats;
+
+	extern const char* search_party_id;
+
+	extern const char* insert_to_party;
+
 	extern const char* insert_to_politician;
 
 	extern const char* insert_to_ratings;
@@ -129,10 +499,28 @@ namespace sql_strings
 
 	extern const char* show_ratings;
 
+	extern const char* search_politicians_batch;
+
+	extern const char* show_ratings_batch;
+
+	extern const char* show_ratings_in_range_asc;
+
+	extern const char* show_ratings_in_range_desc;
+
+	extern const char* show_all_ratings_in_range_asc;
+
+	extern const char* show_all_ratings_in_range_desc;
+
 	extern const char* show_politicians;
 
 	extern const char* show_politicians_compact;
 
+	extern const char* show_politicians_with_ratings;
+
+	extern const char* show_politicians_projected;
+
+	extern const char* count_ratings;
+
 	extern const char* update_party;
 
 	extern const char* delete_politician;
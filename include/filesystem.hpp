@@ -6,8 +6,14 @@
 using std::string;
 
 /**
- * Checks if the HOME environment variable is set and create the directory on
- * which the database file will be stored. Do nothing if the directory exists.
+ * Checks if the HOME environment variable is set and returns the path to the
+ * directory on which the database file is stored. The directory may not exist yet.
  * @return the path to this directory
  */
-string check_create_dirs();
+string get_db_dir();
+
+/**
+ * Creates every unexisting parent directory of 'file'.
+ * Do nothing if they all exist.
+ */
+void create_parent_dirs(const string& file);
@@ -0,0 +1,73 @@
+#ifndef FILTER_HPP
+#define FILTER_HPP
+
+// Standard libraries
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+/** What a comparison of a filter compares */
+enum class filter_field
+{
+	name,
+	party,
+	// Total rating points
+	points,
+	// Number of ratings
+	ratings
+};
+
+enum class filter_op
+{
+	equal,
+	not_equal,
+	less,
+	less_equal,
+	greater,
+	greater_equal
+};
+
+/**
+ * A parsed filter expression over politicians, as a tree: 'all' and 'any' hold
+ * the expressions they combine with AND and OR, 'negation' the negated one.
+ */
+struct filter_expression
+{
+	enum class kind
+	{
+		all,
+		any,
+		negation,
+		// 'field' 'op' the value
+		comparison,
+		// Has a rating at or after the timestamp in 'number'
+		rated_since,
+		// Has a rating before the timestamp in 'number'
+		rated_before
+	};
+
+	kind type;
+	vector<filter_expression> operands;
+
+	filter_field field;
+	filter_op op;
+	// The value compared: the canonical key of a name or party, or a number
+	string text;
+	std::int64_t number;
+};
+
+/**
+ * Parses a filter expression such as
+ * "party = 'X' AND (points > 10 OR NOT ratings < 3) AND rated_since 2022-01-01".
+ * Keywords are case insensitive. Names and parties are quoted and only compared
+ * with = and !=, points and ratings are integers compared with any of
+ * = != < <= > >=. rated_since and rated_before take a local date, or a quoted
+ * date/time (YYYY-MM-DD HH:MM:SS).
+ * Throws std::domain_error, with the position, if 'expression' is invalid.
+ */
+filter_expression parse_filter(const string& expression);
+
+#endif
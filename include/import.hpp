@@ -0,0 +1,39 @@
+#ifndef IMPORT_HPP
+#define IMPORT_HPP
+
+// Standard libraries
+#include <istream>
+#include <ostream>
+
+// Local headers
+#include <storage.hpp>
+
+/**
+ * Imports the ratings of the CSV 'in', one per record:
+ * name,party,points,date/time,description
+ * Fields may be quoted ("..." with "" for a quote), to hold commas or newlines.
+ * An empty date/time means now, otherwise it's a local date/time (with an optional
+ * UTC offset) as accepted by timestamp::parse. A first record starting with "name" is taken as a header.
+ * Every rating is inserted in a single bulk load, so an invalid record aborts the
+ * whole import.
+ * @return the number of ratings imported
+ */
+std::size_t import_ratings(const storage& db, std::istream& in);
+
+struct export_report
+{
+	std::size_t ratings;
+	// Data version of the snapshot the ratings were read from
+	std::int64_t data_version;
+};
+
+/**
+ * Exports every rating to the CSV 'out', in the format import_ratings reads,
+ * after a header record. The ratings are read from a single snapshot, so the
+ * export is consistent even while other connections keep writing.
+ * Date/times carry their UTC offset, so that the hour repeated when the clocks go
+ * back imports unambiguously. Politicians without ratings have no record.
+ */
+export_report export_ratings(const storage& db, std::ostream& out);
+
+#endif
@@ -22,7 +22,7 @@ bool confirm_operation(const string& operation);
  * Set and process the subcommands, options and flags passed on the command line.
  * @return 0 on success and any other integer on error.
  */
-int process_input(int argc, char** argv, const database& db);
+int process_input(int argc, char** argv);
 
 /**
  * Replaces all "\n" of string 'to_replace' with a true newline character.
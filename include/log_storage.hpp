@@ -0,0 +1,118 @@
+#ifndef LOG_STORAGE_HPP
+#define LOG_STORAGE_HPP
+
+// Standard libraries
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// Local headers
+#include <memory_storage.hpp>
+
+/**
+ * Storage engine that appends every change as an event to a log, and keeps the
+ * data (and so the aggregates) in memory, where every query is answered from.
+ *
+ * The log is a directory of numbered segment files, each a sequence of records
+ * made of a length, a CRC-32C checksum and the event. Once the active segment
+ * grows past 'segment_size' it is sealed and a new one is started. A background
+ * thread compacts sealed segments into a snapshot of the data, which replaces
+ * them and any older snapshot.
+ * Opening the engine loads the newest snapshot and replays the segments after
+ * it. A torn record at the end of the last segment (a crash mid-append) is
+ * truncated away, any other corrupt record is an error.
+ * A change is synced to the log before it returns (a bulk load once, when it
+ * succeeds), and is undone in memory if it can't be. Only one process may open
+ * the log at a time, which holds a lock on its LOCK file.
+ */
+struct log_storage : memory_storage
+{
+	// Directory holding the log, with a trailing slash
+	const string dir;
+
+	const std::uint64_t segment_size;
+
+	// Descriptor of the LOCK file, locked for the lifetime of the object
+	int lock_fd;
+
+	// Sealed segments that trigger a compaction
+	const std::uint64_t compact_after;
+
+	// Number of the active segment, and its descriptor and size
+	mutable std::uint64_t active_segment;
+	mutable int active_fd;
+	mutable std::uint64_t active_size;
+
+	// Events of the running bulk load, only appended once it succeeds
+	mutable bool buffering;
+	mutable string pending;
+
+	// Newest segment that was sealed, and the newest one folded into a snapshot
+	mutable std::atomic<std::uint64_t> sealed;
+	std::atomic<std::uint64_t> compacted;
+
+	mutable std::mutex compact_mutex;
+	mutable std::condition_variable compact_wake_up;
+	bool stopping;
+	std::thread compactor;
+
+	/**
+	 * Class constructor.
+	 * Locks and loads the log at 'dir', creating it if it doesn't exist, and
+	 * starts the compaction thread.
+	 * @throw db_exception if another process has the log open
+	 */
+	explicit log_storage(string dir, std::uint64_t segment_size = 8 << 20,
+			std::uint64_t compact_after = 4);
+
+	/**
+	 * Class destructor.
+	 * Waits for a running compaction, closes the active segment and unlocks the log.
+	 */
+	~log_storage() override;
+
+	log_storage(const log_storage&) = delete;
+	log_storage& operator=(const log_storage&) = delete;
+
+	int insert_to_politician(const politician& p) const override;
+
+	int insert_to_ratings(const rating& r) const override;
+
+	int update_party(const politician_update& p) const override;
+
+	int delete_politician(const politician_core& p) const override;
+
+	void bulk_load(const std::function<void()>& load) const override;
+
+	/** Replays the newest snapshot and the segments after it, and opens the active one */
+	void open_log();
+
+	/**
+	 * Appends the encoded 'event' to the active segment.
+	 * @param deferrable whether a running bulk load may buffer it until it succeeds
+	 */
+	void append(const string& event, bool deferrable) const;
+
+	/**
+	 * Writes 'records' to the active segment and syncs it, sealing it if it's full.
+	 * If the write fails, the segment is truncated back to its previous size. If only
+	 * the sealing does, the records stay appended and the next write seals it.
+	 */
+	void write_records(const string& records) const;
+
+	/**
+	 * Syncs the active segment and starts the next one, the compactor then being able
+	 * to read it. Throws if that fails, leaving the active segment as it was.
+	 */
+	void seal_segment() const;
+
+	/** Body of the compaction thread */
+	void run_compactor();
+
+	/** Folds the snapshot and segments up to 'last' into a new snapshot */
+	void compact(std::uint64_t last);
+};
+
+#endif
@@ -0,0 +1,169 @@
+#ifndef MEMORY_STORAGE_HPP
+#define MEMORY_STORAGE_HPP
+
+// Standard libraries
+#include <set>
+#include <unordered_map>
+
+// Local headers
+#include <storage.hpp>
+
+/**
+ * Storage engine that keeps everything in memory, in hash maps and sorted
+ * vectors, and persists nothing. Meant for benchmarks and ephemeral workloads.
+ */
+struct memory_storage : storage
+{
+	struct stored_rating
+	{
+		std::int64_t date_time;
+		short points;
+		string description;
+	};
+
+	struct stored_politician
+	{
+		string name;
+		string name_key;
+		std::size_t party_id;
+		string info;
+		std::int64_t total_rating;
+		// Sorted by date/time
+		vector<stored_rating> ratings;
+		rating_histogram histogram;
+	};
+
+	// Parties by id, and ids by canonical key
+	mutable vector<party_handle> parties;
+	mutable std::unordered_map<string, std::size_t> party_ids;
+	// Total rating and histogram of the members of each party, by party id
+	mutable vector<std::int64_t> party_totals;
+	mutable vector<rating_histogram> party_histograms;
+
+	// Politicians by id, and ids by canonical name key and by party id (sorted)
+	mutable std::unordered_map<std::int64_t, stored_politician> politicians;
+	mutable std::unordered_map<string, vector<std::int64_t>> politicians_by_name;
+	mutable vector<vector<std::int64_t>> politicians_by_party;
+	mutable std::int64_t next_politician_id;
+	// (date/time, politician id) of every rating, for ranges over every politician
+	mutable std::set<std::pair<std::int64_t, std::int64_t>> ratings_by_date;
+
+	// Number of changes to the politicians and ratings, the version of the data
+	mutable std::int64_t data_version;
+
+	// Ratings inserted by the running bulk load, undone if it fails
+	mutable bool bulk_loading;
+	mutable vector<std::pair<std::int64_t, std::int64_t>> bulk_loaded;
+
+	/** Class constructor. Starts empty */
+	memory_storage();
+
+	int insert_to_politician(const politician& p) const override;
+
+	int insert_to_ratings(const rating& r) const override;
+
+	int update_party(const politician_update& p) const override;
+
+	int delete_politician(const politician_core& p) const override;
+
+	const vector<politician> get_politician_by_name(const string& name) const override;
+
+	const vector<politician> get_politicians_by_party(const string& party) const override;
+
+	const vector<rating> get_politician_ratings(const politician_core& p) const override;
+
+	const vector<std::optional<politician>> get_politicians_batch(
+			const vector<politician_core>& keys) const override;
+
+	const vector<vector<rating>> get_ratings_batch(
+			const vector<politician_core>& keys) const override;
+
+	const vector<rating> get_ratings_in_range(const politician_core& p,
+			const rating_range& range) const override;
+
+	const vector<rating> get_all_ratings_in_range(const rating_range& range) const override;
+
+	const vector<politician> get_all_politicians(const string& order = "DESC") const override;
+
+	const vector<politician_core> get_politicians_compact(
+			const string& order = "DESC") const override;
+
+	void for_each_politician_with_ratings(std::size_t latest, const string& order,
+			const politician_visitor& visit) const override;
+
+	const vector<projected_politician> get_politicians_projected(
+			const vector<politician_field>& fields, const string& order = "DESC") const override;
+
+	const vector<politician> get_politicians_where(
+			const filter_expression& filter) const override;
+
+	std::int64_t count_politicians_by_name(const string& name,
+			bool exists = false) const override;
+
+	std::int64_t count_politicians_by_party(const string& party,
+			bool exists = false) const override;
+
+	std::int64_t count_ratings_in_range(const politician_core& p,
+			const rating_range& range, bool exists = false) const override;
+
+	std::int64_t count_all_ratings_in_range(const rating_range& range,
+			bool exists = false) const override;
+
+	std::int64_t count_politicians(bool exists = false) const override;
+
+	std::int64_t count_politicians_where(const filter_expression& filter,
+			bool exists = false) const override;
+
+	std::int64_t count_politicians_batch(const vector<politician_core>& keys,
+			bool exists = false) const override;
+
+	std::int64_t count_parties(bool exists = false) const override;
+
+	const vector<party_summary> get_party_leaderboard(const string& by = "total",
+			const string& order = "DESC") const override;
+
+	rating_histogram get_politician_histogram(const politician_core& p) const override;
+
+	rating_histogram get_party_histogram(const string& party) const override;
+
+	vector<politician_stats> get_politician_stats() const override;
+
+	void bulk_load(const std::function<void()>& load) const override;
+
+	/** There are no other connections, 'read' runs over the data as is */
+	void read_snapshot(const std::function<void(std::int64_t)>& read) const override;
+
+	verify_report verify_totals(unsigned threads, bool fix) const override;
+
+	/**
+	 * Retrieves the id of the party with the canonical key 'party_key'.
+	 * @return the id, or parties.size() if there's no such party
+	 */
+	std::size_t find_party(const string& party_key) const;
+
+	/**
+	 * Retrieves the id of 'party', creating it if it doesn't exist.
+	 */
+	std::size_t find_or_add_party(const party_handle& party) const;
+
+	/**
+	 * Retrieves the politician 'name' of 'party', by their canonical keys.
+	 * @return the id of the politician, 0 if it doesn't exist
+	 */
+	std::int64_t find_politician(const string& name_key, const party_handle& party) const;
+
+	/** Removes the rating of the politician 'id' at 'date_time', and it from the aggregates */
+	void remove_rating(std::int64_t id, std::int64_t date_time) const;
+
+	/** Checks if the politician 'p' matches 'filter' */
+	bool matches(const filter_expression& filter, const stored_politician& p) const;
+
+	/**
+	 * Retrieves every politician, ordered as get_all_politicians does.
+	 * @param order "DESC" or "ASC"
+	 */
+	vector<const stored_politician*> sorted_politicians(const string& order,
+			const string& function_name) const;
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef NORMALIZE_HPP
+#define NORMALIZE_HPP
+
+// Standard libraries
+#include <locale>
+#include <string>
+#include <string_view>
+
+using std::string;
+
+/**
+ * The user's default locale, generated the first time it's needed.
+ */
+const std::locale& user_locale();
+
+/**
+ * Checks if every byte of 'text' is ASCII.
+ */
+bool is_ascii(std::string_view text);
+
+/**
+ * Converts the UTF-8 'text' to uppercase.
+ * Runs of ASCII characters are converted by a vectorised fast path, only the runs
+ * of non-ASCII characters go through Boost.Locale (with the user's locale).
+ * Shared by every path that stores or looks up names and parties, so that they
+ * are all case insensitive in the same way.
+ */
+string to_upper(std::string_view text);
+
+/**
+ * Builds the canonical lookup key of the UTF-8 'text': NFC normalized and case
+ * folded, so that "José" and "JOSÉ" share the same key.
+ * Plain ASCII text takes a vectorised fast path.
+ * @param strip_diacritics also removes accents and other diacritics, so that
+ * "JOSÉ" and "JOSE" share the same key
+ */
+string canonical_key(std::string_view text, bool strip_diacritics = true);
+
+#endif
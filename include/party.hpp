@@ -0,0 +1,49 @@
+#ifndef PARTY_HPP
+#define PARTY_HPP
+
+// Standard libraries
+#include <ostream>
+#include <string>
+#include <string_view>
+
+using std::string;
+
+struct interned_party;
+
+/**
+ * Handle to a party name stored in the process-wide intern pool.
+ * Every handle to the same name points to the same pool entry, so handles are
+ * as cheap to copy as a pointer and compare by address.
+ */
+struct party_handle
+{
+	const interned_party* entry;
+
+	/** Constructor. Interns 'name' */
+	party_handle(std::string_view name);
+
+	/** Constructor. Interns 'name' */
+	party_handle(const string& name);
+
+	/** Constructor. Interns 'name' */
+	party_handle(const char* name);
+
+	/** The party name */
+	const string& str() const;
+
+	/** The party name as a C string */
+	const char* c_str() const;
+
+	/** The canonical lookup key of the name, computed once per interned name */
+	const string& key() const;
+
+	operator const string&() const;
+
+	bool operator==(const party_handle& other) const;
+
+	bool operator!=(const party_handle& other) const;
+};
+
+std::ostream& operator<<(std::ostream& out, const party_handle& party);
+
+#endif
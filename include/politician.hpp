@@ -2,17 +2,26 @@
 #define POLITICIAN_HPP
 
 // Standard libraries
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <ostream>
 #include <string>
+#include <vector>
+
+// Local headers
+#include <party.hpp>
 
 using std::string;
+using std::vector;
 
 struct politician_core
 {
 	const string name;
-	const string party;
+	const party_handle party;
 
 	/** Constructor */
-	politician_core(string name, string party);
+	politician_core(string name, party_handle party);
 
 	/** Prints all the data stored for politician_core */
 	virtual void print_data() const;
@@ -20,10 +29,10 @@ struct politician_core
 
 struct politician_update : politician_core
 {
-	const string new_party;
+	const party_handle new_party;
 
 	/** Constructor */
-	politician_update(string name, string party, string new_party);
+	politician_update(string name, party_handle party, party_handle new_party);
 
 	/** Prints all the data stored for politician_update */
 	void print_data() const;
@@ -35,24 +44,92 @@ struct politician : politician_core
 	const short points;
 
 	/** Constructor */
-	politician(string name, string party, string info, const short points = 0);
+	politician(string name, party_handle party, string info, const short points = 0);
 
 	/** Prints all the data stored for politician */
 	void print_data() const;
 };
 
+/** Fields of a politician that searches can be projected on */
+enum class politician_field
+{
+	name,
+	party,
+	information,
+	// Total rating points
+	points,
+	// Number of ratings
+	ratings
+};
+
+/** A politician projected on some of its fields, only those being set */
+struct projected_politician
+{
+	string name;
+	std::optional<party_handle> party;
+	string info;
+	std::int64_t points = 0;
+	std::int64_t ratings = 0;
+
+	/** Prints the 'fields' it was projected on, in that order */
+	void print_data(const vector<politician_field>& fields) const;
+};
+
 struct rating : politician_core
 {
 	const string description;
 	const short points;
-	const string date_time;
+	// Microseconds since the Unix epoch (UTC), 0 to timestamp it when inserted
+	const std::int64_t date_time;
 
 	/** Constructor */
-	rating(string name, string party, string description, const short points,
-			string date_time = "");
+	rating(string name, party_handle party, string description, const short points,
+			std::int64_t date_time = 0);
 
 	/** Prints all the data stored for the rating */
 	void print_data() const;
+
+	/** Prints the date/time, points and description on an indented line */
+	void print_line() const;
+};
+
+struct party_summary
+{
+	const party_handle party;
+	const std::int64_t members;
+	const std::int64_t total_rating;
+
+	/** Constructor */
+	party_summary(party_handle party, std::int64_t members, std::int64_t total_rating);
+
+	/** Average rating points of the members */
+	double average() const;
+
+	/** Prints all the data stored for the party */
+	void print_data() const;
+};
+
+struct rating_histogram
+{
+	// Ratings points are bounded to [min_points, max_points]
+	static constexpr short min_points = -5;
+	static constexpr short max_points = 5;
+
+	// Number of ratings with each of the points, counts[0] being min_points'
+	std::array<std::int64_t, max_points - min_points + 1> counts{};
+
+	/** Number of ratings with 'points' */
+	std::int64_t& operator[](short points);
+	std::int64_t operator[](short points) const;
+
+	/** Number of ratings of every points */
+	std::int64_t ratings() const;
+
+	/** Prints a bar per points, scaled to the most frequent one */
+	void print_data() const;
+
+	/** Prints the counts as a JSON object, {"ratings": N, "counts": {"-5": N, ...}} */
+	void print_json(std::ostream& out) const;
 };
 
 #endif
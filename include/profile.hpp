@@ -0,0 +1,38 @@
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+// Standard libraries
+#include <chrono>
+#include <ostream>
+
+/**
+ * Measures the duration of a startup phase, from its construction to its
+ * destruction, and records it in the startup profile.
+ * Recording is cheap enough to be always on, the profile is only reported
+ * when requested.
+ */
+struct startup_phase
+{
+	const char* name;
+	const std::chrono::steady_clock::time_point start;
+
+	/** Constructor. Starts timing the phase 'name' (must be a string literal) */
+	explicit startup_phase(const char* name);
+
+	/** Destructor. Records the phase in the startup profile */
+	~startup_phase();
+};
+
+namespace startup_profile
+{
+	/**
+	 * Marks the beginning of the program, relative to which every phase is reported.
+	 * Must be called as early as possible in 'main'.
+	 */
+	void start();
+
+	/** Prints every recorded phase with its start offset and duration */
+	void print(std::ostream& out);
+}
+
+#endif
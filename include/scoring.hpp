@@ -0,0 +1,68 @@
+#ifndef SCORING_HPP
+#define SCORING_HPP
+
+// Standard libraries
+#include <cstdint>
+#include <vector>
+
+// Local headers
+#include <politician.hpp>
+#include <storage.hpp>
+
+using std::vector;
+
+/**
+ * The features of every politician that custom rankings are scored on, stored
+ * column by column so that the scoring kernel streams through contiguous arrays.
+ */
+struct feature_table
+{
+	vector<politician_core> politicians;
+
+	// Total rating points
+	vector<float> total;
+	// Mean rating points, 0 without ratings
+	vector<float> mean;
+	// 1 / (1 + days since the latest rating), 0 without ratings
+	vector<float> recency;
+	// Number of ratings with negative points
+	vector<float> negatives;
+
+	/**
+	 * Class constructor.
+	 * Computes the features from the 'stats' of the politicians.
+	 * @param now the timestamp the recency is measured from
+	 */
+	feature_table(const vector<politician_stats>& stats, std::int64_t now);
+
+	/** Number of politicians */
+	std::size_t size() const;
+};
+
+/** Weight of each feature in the score, which is their weighted sum */
+struct score_weights
+{
+	float total = 1;
+	float mean = 0;
+	float recency = 0;
+	float negatives = 0;
+};
+
+struct ranked_politician
+{
+	// Index of the politician in the feature_table
+	std::size_t index;
+	float score;
+};
+
+/**
+ * Scores every politician of 'features' and retrieves the 'k' highest scores.
+ * The scores are computed by a vectorised kernel (AVX or SSE when available),
+ * which only leaves it for the blocks holding a score above the lowest of the
+ * best 'k' found so far.
+ * @return the best 'k' politicians, highest score first, ties by index
+ */
+vector<ranked_politician> top_k(const feature_table& features, const score_weights& weights,
+		std::size_t k);
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+// Standard libraries
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+// Local headers
+#include <trace.hpp>
+
+namespace query_stats
+{
+	// Whether query timers record anything. Set before any query runs.
+	extern bool enabled;
+
+	/** Starts recording the statistics of every instrumented operation */
+	void enable();
+
+	/** Prints the statistics of every operation called at least once */
+	void print(std::ostream& out);
+}
+
+/**
+ * Statistics of one instrumented operation, registered in the process-wide
+ * registry on construction. Meant to be a function-local static of the operation.
+ */
+struct query_counters
+{
+	const char* const name;
+
+	std::atomic<std::uint64_t> calls;
+	std::atomic<std::uint64_t> total_ns;
+	std::atomic<std::uint64_t> min_ns;
+	std::atomic<std::uint64_t> max_ns;
+	std::atomic<std::uint64_t> rows;
+	std::atomic<std::uint64_t> bytes;
+
+	// Next operation in the registry
+	query_counters* next;
+
+	/** Constructor. Registers the operation 'name' (must outlive the counters) */
+	explicit query_counters(const char* name);
+
+	/** Adds one call that lasted 'ns' nanoseconds and handled 'rows' rows and 'bytes' bytes */
+	void record(std::uint64_t ns, std::uint64_t rows, std::uint64_t bytes);
+};
+
+/**
+ * Times one call of an operation and accumulates the rows and bytes it handled.
+ * The call is also recorded as a trace span when tracing is enabled.
+ * When both are disabled it does nothing besides a branch.
+ */
+struct query_timer
+{
+	query_counters& counters;
+	const bool active;
+	std::chrono::steady_clock::time_point start;
+	std::uint64_t rows = 0;
+	std::uint64_t bytes = 0;
+
+	/** Constructor. Starts timing */
+	explicit query_timer(query_counters& counters)
+		: counters(counters), active(query_stats::enabled || trace::enabled)
+	{
+		if(active)
+			start = std::chrono::steady_clock::now();
+	}
+
+	/** Accounts a row of 'row_bytes' bytes retrieved or written by the operation */
+	void add_row(std::size_t row_bytes)
+	{
+		if(active)
+		{
+			++rows;
+			bytes += row_bytes;
+		}
+	}
+
+	/** Accounts 'count' rows affected by the operation */
+	void add_rows(int count)
+	{
+		if(active && count > 0)
+			rows += static_cast<std::uint64_t>(count);
+	}
+
+	/** Destructor. Records the call in the operation's counters */
+	~query_timer()
+	{
+		if(active)
+		{
+			auto end = std::chrono::steady_clock::now();
+			if(query_stats::enabled)
+				counters.record(static_cast<std::uint64_t>(
+						std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()),
+						rows, bytes);
+			if(trace::enabled)
+				trace::complete(counters.name, start, end);
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,307 @@
+#ifndef STORAGE_HPP
+#define STORAGE_HPP
+
+// Standard libraries
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Local headers
+#include <filter.hpp>
+#include <politician.hpp>
+
+using std::string;
+using std::vector;
+
+/**
+ * An aggregate of a politician or party whose stored value differs from the one
+ * computed from the ratings.
+ */
+struct aggregate_drift
+{
+	// 0, with an empty name, for an aggregate of the party
+	std::int64_t politician_id;
+	std::int64_t party_id;
+	string name;
+	string party;
+	// Name of the aggregate: total_rating, member_count or histogram
+	string aggregate;
+	// Points of the histogram count, 0 for the other aggregates
+	short points;
+	std::int64_t stored;
+	std::int64_t actual;
+};
+
+struct verify_report
+{
+	std::int64_t politicians;
+	std::int64_t parties;
+	vector<aggregate_drift> drifts;
+};
+
+/** Aggregates of a politician that custom rankings are computed from */
+struct politician_stats
+{
+	string name;
+	party_handle party;
+	std::int64_t total_rating;
+	std::int64_t ratings;
+	// Ratings with negative points
+	std::int64_t negatives;
+	// Date/time of the latest rating, 0 without ratings
+	std::int64_t latest_rating;
+};
+
+/** Selects the ratings of a date/time range, in order of their date/time */
+struct rating_range
+{
+	// Start of the range, included
+	std::int64_t from = std::numeric_limits<std::int64_t>::min();
+	// End of the range, excluded
+	std::int64_t to = std::numeric_limits<std::int64_t>::max();
+	// Newest first instead of oldest first
+	bool descending = false;
+	// Maximum number of ratings, 0 for all of them
+	std::size_t limit = 0;
+};
+
+/** Receives a politician and some of its ratings */
+using politician_visitor = std::function<void(const politician&, const vector<rating>&)>;
+
+/**
+ * Storage engine of politicians and ratings.
+ * Names and parties are looked up by their canonical keys, and errors are
+ * reported with the exceptions of exceptions.hpp, whatever the engine.
+ * Engines aren't thread safe, each one must only be used by a thread at a time.
+ */
+struct storage
+{
+	/** Class destructor */
+	virtual ~storage() = default;
+
+	/**
+	 * Inserts a new politician.
+	 * @return the number of affected rows
+	 */
+	virtual int insert_to_politician(const politician& p) const = 0;
+
+	/**
+	 * Inserts a new rating, timestamped now if it has no date/time.
+	 * @return the number of affected rows
+	 */
+	virtual int insert_to_ratings(const rating& r) const = 0;
+
+	/**
+	 * Update the party of a politician.
+	 * @return the number of affected rows
+	 */
+	virtual int update_party(const politician_update& p) const = 0;
+
+	/**
+	 * Delete a politician and its ratings.
+	 * @return the number of affected rows
+	 */
+	virtual int delete_politician(const politician_core& p) const = 0;
+
+	/**
+	 * Retrives all politician which matches the 'name'.
+	 * @return a vector of all politicians retrieved.
+	 */
+	virtual const vector<politician> get_politician_by_name(const string& name) const = 0;
+
+	/**
+	 * Retrives all politicians belonging to a party.
+	 * @return a vector of all politicians belonging to party.
+	 */
+	virtual const vector<politician> get_politicians_by_party(const string& party) const = 0;
+
+	/**
+	 * Retrives all the ratings belonging to a politician, oldest first.
+	 * @return a vector of all ratings belonging to politician.
+	 */
+	virtual const vector<rating> get_politician_ratings(const politician_core& p) const = 0;
+
+	/**
+	 * Retrieves the politicians of many (name, party) keys at once.
+	 * @return a vector with the politician of each of the 'keys', in their order,
+	 * empty if it doesn't exist
+	 */
+	virtual const vector<std::optional<politician>> get_politicians_batch(
+			const vector<politician_core>& keys) const = 0;
+
+	/**
+	 * Retrieves the ratings of many politicians at once, grouped by politician.
+	 * @return a vector with the ratings of each of the 'keys', in their order, each
+	 * politician's oldest first and empty if it doesn't exist
+	 */
+	virtual const vector<vector<rating>> get_ratings_batch(
+			const vector<politician_core>& keys) const = 0;
+
+	/**
+	 * Retrieves the ratings of a politician in 'range', only reading those.
+	 * @return a vector of the ratings, ordered by date/time as 'range' asks
+	 */
+	virtual const vector<rating> get_ratings_in_range(const politician_core& p,
+			const rating_range& range) const = 0;
+
+	/**
+	 * Retrieves the ratings of every politician in 'range', only reading those.
+	 * @return a vector of the ratings, ordered by date/time and then by the order
+	 * the politicians were inserted, both reversed if 'range' is descending
+	 */
+	virtual const vector<rating> get_all_ratings_in_range(const rating_range& range) const = 0;
+
+	/**
+	 * Retrives all politicians, ordered by their rating points, then name and party.
+	 * @param order "DESC" or "ASC"
+	 * @return a vector of all politicians.
+	 */
+	virtual const vector<politician> get_all_politicians(
+			const string& order = "DESC") const = 0;
+
+	/**
+	 * Compact version of function 'get_all_politicians'.
+	 * Only returns the names and parties of the politicians.
+	 */
+	virtual const vector<politician_core> get_politicians_compact(
+			const string& order = "DESC") const = 0;
+
+	/**
+	 * Visits every politician, ordered as get_all_politicians does, each with its
+	 * 'latest' most recent ratings, newest first. 'visit' is called once per
+	 * politician, so the caller only holds the ratings of one politician at a time.
+	 * @param order "DESC" or "ASC"
+	 */
+	virtual void for_each_politician_with_ratings(std::size_t latest, const string& order,
+			const politician_visitor& visit) const = 0;
+
+	/**
+	 * Version of function 'get_all_politicians' that only reads the 'fields' of
+	 * the politicians.
+	 * @param order "DESC" or "ASC"
+	 * @return a vector of all politicians, only their 'fields' set
+	 */
+	virtual const vector<projected_politician> get_politicians_projected(
+			const vector<politician_field>& fields, const string& order = "DESC") const = 0;
+
+	/**
+	 * Retrives the politicians matching 'filter', ordered as get_all_politicians
+	 * does ("DESC").
+	 * @return a vector of the matching politicians.
+	 */
+	virtual const vector<politician> get_politicians_where(
+			const filter_expression& filter) const = 0;
+
+	/**
+	 * Counts the politicians get_politician_by_name retrieves, without reading them.
+	 * @param exists only checks whether there's any, stopping at the first one
+	 * @return the number of politicians, or 1 or 0 if 'exists' is set
+	 */
+	virtual std::int64_t count_politicians_by_name(const string& name,
+			bool exists = false) const = 0;
+
+	/** Counts the politicians get_politicians_by_party retrieves, as the function above */
+	virtual std::int64_t count_politicians_by_party(const string& party,
+			bool exists = false) const = 0;
+
+	/** Counts the ratings get_ratings_in_range retrieves, as the functions above */
+	virtual std::int64_t count_ratings_in_range(const politician_core& p,
+			const rating_range& range, bool exists = false) const = 0;
+
+	/** Counts the ratings get_all_ratings_in_range retrieves, as the functions above */
+	virtual std::int64_t count_all_ratings_in_range(const rating_range& range,
+			bool exists = false) const = 0;
+
+	/** Counts the politicians get_all_politicians retrieves, as the functions above */
+	virtual std::int64_t count_politicians(bool exists = false) const = 0;
+
+	/** Counts the politicians get_politicians_where retrieves, as the functions above */
+	virtual std::int64_t count_politicians_where(const filter_expression& filter,
+			bool exists = false) const = 0;
+
+	/** Counts the politicians get_politicians_batch finds, as the functions above */
+	virtual std::int64_t count_politicians_batch(const vector<politician_core>& keys,
+			bool exists = false) const = 0;
+
+	/** Counts the parties get_party_leaderboard retrieves, as the functions above */
+	virtual std::int64_t count_parties(bool exists = false) const = 0;
+
+	/**
+	 * Retrieves every party with members, with its member count and the total of
+	 * its members' ratings, which are kept up to date as ratings are inserted.
+	 * @param by what the parties are ordered by: "total", "avg" or "count"
+	 * @param order "DESC" or "ASC"
+	 * @return a vector of all parties, ties ordered by name
+	 */
+	virtual const vector<party_summary> get_party_leaderboard(const string& by = "total",
+			const string& order = "DESC") const = 0;
+
+	/**
+	 * Retrieves how many ratings of each points a politician has, which is kept up
+	 * to date as ratings are inserted rather than counted from them.
+	 * @return the histogram, empty if the politician doesn't exist
+	 */
+	virtual rating_histogram get_politician_histogram(const politician_core& p) const = 0;
+
+	/**
+	 * Retrieves how many ratings of each points the members of a party have.
+	 * @return the histogram, empty if the party doesn't exist
+	 */
+	virtual rating_histogram get_party_histogram(const string& party) const = 0;
+
+	/**
+	 * Retrieves the aggregates of every politician, from the maintained aggregates
+	 * and without scanning the ratings.
+	 * @return a vector of the stats of every politician, ordered as inserted
+	 */
+	virtual vector<politician_stats> get_politician_stats() const = 0;
+
+	/**
+	 * Runs 'load', which inserts many ratings, as a single unit: if it throws none
+	 * of the ratings it inserted are kept. Engines may defer the maintenance of
+	 * aggregates until 'load' is over.
+	 */
+	virtual void bulk_load(const std::function<void()>& load) const = 0;
+
+	/**
+	 * Runs 'read' over a snapshot of the data: every query it runs sees the data as
+	 * committed when the snapshot was taken, even if other connections commit
+	 * changes meanwhile, and without blocking them.
+	 * 'read' receives the data version of the snapshot, which grows with every
+	 * change to the politicians and ratings, so reads of the same version saw the
+	 * same data.
+	 */
+	virtual void read_snapshot(const std::function<void(std::int64_t)>& read) const = 0;
+
+	/**
+	 * Recomputes every aggregate from the ratings and compares it with the stored
+	 * one: the total rating and histogram of each politician, and the member count,
+	 * total rating and histogram of each party.
+	 * @param threads how many threads may share the work
+	 * @param fix also stores the recomputed values of the drifted aggregates
+	 * @return the drifts of the politicians, by id, then those of the parties
+	 */
+	virtual verify_report verify_totals(unsigned threads, bool fix) const = 0;
+};
+
+/** Values of the 'by' parameter of storage::get_party_leaderboard */
+const vector<string>& leaderboard_orders();
+
+/** Names of the values of politician_field, in their order */
+const vector<string>& politician_fields();
+
+/** Names of the available storage engines, the default one first */
+const vector<string>& storage_engines();
+
+/**
+ * Opens the storage engine named 'engine'.
+ * @param file the file (or directory) of the engine, empty for its default one.
+ * Ignored by the engines that don't persist anything.
+ */
+std::unique_ptr<storage> open_storage(const string& engine, const string& file = "");
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef TIMESTAMP_HPP
+#define TIMESTAMP_HPP
+
+// Standard libraries
+#include <cstdint>
+#include <string>
+
+using std::string;
+
+/**
+ * Rating timestamps: microseconds since the Unix epoch, in UTC.
+ */
+namespace timestamp
+{
+	/**
+	 * The current time. Every call within the process returns a later timestamp
+	 * than the previous one, even when the clock hasn't advanced or went backwards,
+	 * so that ratings inserted in a burst never collide.
+	 */
+	std::int64_t now();
+
+	/**
+	 * Parses a local "YYYY-MM-DD HH:MM:SS" date/time, optionally followed by up to
+	 * six fractional digits, or a "YYYY-MM-DD" date alone, which is its midnight.
+	 * The date/time may end with its UTC offset, "Z" or "+HH:MM"/"-HH:MM", which
+	 * makes it unambiguous when the clocks go back.
+	 * Throws a std::domain_error if it's malformed.
+	 */
+	std::int64_t parse(const string& date_time);
+
+	/**
+	 * Formats 'time' as a local "YYYY-MM-DD HH:MM:SS" date/time, followed by the
+	 * microseconds when there are any.
+	 * @param with_offset also append the UTC offset, as "+HH:MM" or "-HH:MM"
+	 */
+	string format(std::int64_t time, bool with_offset = false);
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+// Standard libraries
+#include <chrono>
+#include <string>
+
+using std::string;
+
+namespace trace
+{
+	using clock = std::chrono::steady_clock;
+
+	// Whether spans are recorded. Set before any span of interest starts.
+	extern bool enabled;
+
+	/** Starts recording spans */
+	void enable();
+
+	/**
+	 * Records a span named 'name' (must be a string literal) that lasted from
+	 * 'start' to 'end' in the calling thread's ring buffer.
+	 * The buffer keeps the most recent events, so recording never blocks or allocates,
+	 * besides creating the buffer on the thread's first event.
+	 */
+	void complete(const char* name, clock::time_point start, clock::time_point end);
+
+	/**
+	 * Writes every recorded span, of every thread, to 'file' in the Chrome trace
+	 * event format (loadable by chrome://tracing and Perfetto).
+	 */
+	void write(const string& file);
+}
+
+/**
+ * Records a span from its construction to its destruction, when tracing is enabled.
+ * When it's disabled it does nothing besides a branch.
+ */
+struct trace_span
+{
+	const char* name;
+	const bool active;
+	trace::clock::time_point start;
+
+	/** Constructor. Starts the span 'name' (must be a string literal) */
+	explicit trace_span(const char* name)
+		: name(name), active(trace::enabled)
+	{
+		if(active)
+			start = trace::clock::now();
+	}
+
+	/** Ends the current span and starts the span 'next_name' right after it */
+	void next(const char* next_name)
+	{
+		if(active)
+		{
+			auto now = trace::clock::now();
+			trace::complete(name, start, now);
+			name = next_name;
+			start = now;
+		}
+	}
+
+	/** Destructor. Ends the span */
+	~trace_span()
+	{
+		if(active)
+			trace::complete(name, start, trace::clock::now());
+	}
+};
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef WRITE_QUEUE_HPP
+#define WRITE_QUEUE_HPP
+
+// Standard libraries
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+
+// Local headers
+#include <database.hpp>
+
+/**
+ * Group commit of database writes, for long-running processes.
+ * Any number of threads enqueue writes, which a single writer thread applies to
+ * the database in batches, one transaction per batch, instead of paying for a
+ * transaction (and its disk syncs) per write.
+ * Each write gets a future, which is only fulfilled once the transaction holding
+ * the write was committed, with either the number of affected rows or the
+ * exception the write (or the commit) failed with.
+ * While the queue exists the database belongs to its writer thread: other threads
+ * must not use it at all, not even to read, as its statement cache isn't
+ * synchronised. Reads need a database of their own.
+ */
+class write_queue
+{
+	public:
+		// A write, returning the number of affected rows
+		using operation = std::function<int(const database&)>;
+
+		/**
+		 * Class constructor.
+		 * Starts the writer thread.
+		 * @param max_batch the maximum number of writes committed together
+		 * @param max_delay how long the writer keeps collecting writes for a batch,
+		 * 0 commits whatever is queued as soon as the writer is free
+		 */
+		explicit write_queue(const database& db, std::size_t max_batch = 1000,
+				std::chrono::microseconds max_delay = std::chrono::microseconds(0));
+
+		/**
+		 * Class destructor.
+		 * Commits every write still queued and stops the writer thread.
+		 */
+		~write_queue();
+
+		write_queue(const write_queue&) = delete;
+		write_queue& operator=(const write_queue&) = delete;
+
+		/** Enqueues 'op' to be applied by the writer thread */
+		std::future<int> submit(operation op);
+
+		/** Enqueues database::insert_to_politician */
+		std::future<int> insert_to_politician(politician p);
+
+		/** Enqueues database::insert_to_ratings */
+		std::future<int> insert_to_ratings(rating r);
+
+		/** Enqueues database::update_party */
+		std::future<int> update_party(politician_update p);
+
+		/** Enqueues database::delete_politician */
+		std::future<int> delete_politician(politician_core p);
+
+	private:
+		struct node
+		{
+			std::atomic<node*> next;
+			operation op;
+			std::promise<int> result;
+		};
+
+		// A write taken out of the queue
+		struct request
+		{
+			operation op;
+			std::promise<int> result;
+		};
+
+		const database& db;
+		const std::size_t max_batch;
+		const std::chrono::microseconds max_delay;
+
+		// Intrusive MPSC queue (Vyukov): producers exchange 'head', only the writer
+		// thread touches 'tail', which always points to an already consumed node
+		std::atomic<node*> head;
+		node* tail;
+
+		// Only used to put the writer to sleep while the queue is empty
+		std::mutex sleep_mutex;
+		std::condition_variable wake_up;
+		std::atomic<bool> sleeping;
+		std::atomic<bool> stopping;
+
+		std::thread writer;
+
+		/** Takes the oldest write out of the queue, false if it's empty */
+		bool pop(request& out);
+
+		/**
+		 * Waits for the next write, false once the queue is stopping and has been
+		 * drained.
+		 */
+		bool wait_pop(request& out);
+
+		/** Body of the writer thread */
+		void run();
+
+		/** Applies the writes in 'batch' in a single transaction */
+		void commit_batch(vector<request>& batch);
+};
+
+#endif
@@ -1,11 +1,21 @@
 // Standard libraries
+#include <algorithm>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <limits>
+#include <thread>
+#include <unordered_map>
 
 // Local headers
 #include <database.hpp>
 #include <exceptions.hpp>
 #include <filesystem.hpp>
+#include <normalize.hpp>
+#include <profile.hpp>
+#include <stats.hpp>
+#include <timestamp.hpp>
+#include <trace.hpp>
 
 using std::string;
 using std::move;
@@ -25,13 +35,249 @@ inline void check_return(
 		throw Except(move(operation), move(function_name), return_code, errmsg);
 }
 
-database::database()
+/**
+ * Maps the party ids read by a query to party handles, so that the rows of the
+ * same party share a handle instead of interning the party name once per row.
+ */
+struct party_cache
+{
+	std::unordered_map<sqlite3_int64, party_handle> handles;
+
+	/**
+	 * Reads the party of the current row of 'stmt', whose id is in column
+	 * 'id_column' and name in column 'id_column' + 1.
+	 */
+	party_handle read(sqlite3_stmt* stmt, int id_column)
+	{
+		sqlite3_int64 id = sqlite3_column_int64(stmt, id_column);
+		auto it = handles.find(id);
+		if(it == handles.end())
+		{
+			party_handle party((const char*) sqlite3_column_text(stmt, id_column + 1));
+			it = handles.emplace(id, party).first;
+		}
+		return it->second;
+	}
+};
+
+/**
+ * SQL function canonical_key(text), returns the canonical lookup key of 'text'.
+ */
+void sql_canonical_key(sqlite3_context* context, int, sqlite3_value** argv)
+{
+	const char* text = reinterpret_cast<const char*>(sqlite3_value_text(argv[0]));
+	if(text == nullptr)
+	{
+		sqlite3_result_null(context);
+		return;
+	}
+
+	try
+	{
+		string key = canonical_key(std::string_view(text,
+				static_cast<std::size_t>(sqlite3_value_bytes(argv[0]))));
+		sqlite3_result_text(context, key.c_str(), static_cast<int>(key.size()),
+				SQLITE_TRANSIENT);
+	}
+	catch(const std::exception& e)
+	{
+		sqlite3_result_error(context, e.what(), -1);
+	}
+}
+
+/**
+ * Busy handler of the connections, called by SQLite while another connection
+ * holds the lock 'db' needs, with the number of times it was called for that lock.
+ * Sleeps a backoff as set by database::busy, recording it as a lock wait.
+ * @return 0 to give up, once the timeout is over, or 1 to retry
+ */
+int wait_for_lock(void* data, int retries)
+{
+	static query_counters counters("lock_wait");
+	const database& db = *static_cast<const database*>(data);
+	const busy_policy& policy = database::busy;
+
+	const auto now = std::chrono::steady_clock::now();
+	if(retries == 0)
+		db.busy_since = now;
+	const auto left = policy.timeout - (now - db.busy_since);
+	if(left <= left.zero())
+		return 0;
+
+	// Doubling more than 30 times would overflow, and exceeds any sensible maximum
+	const auto backoff = retries >= 30 ? policy.max_backoff
+		: std::min(policy.initial_backoff * (std::int64_t(1) << retries), policy.max_backoff);
+	std::uniform_int_distribution<std::int64_t> jitter(backoff.count() / 2, backoff.count());
+	const auto sleep = std::min<std::chrono::steady_clock::duration>(
+			std::chrono::microseconds(jitter(db.busy_jitter)), left);
+
+	query_timer timer(counters);
+	std::this_thread::sleep_for(sleep);
+	return 1;
+}
+
+/**
+ * Appends the SQL condition of 'filter', over politician p and party pt, to 'sql',
+ * and the values it compares to 'texts' or 'numbers', in the order of their
+ * parameters. Values are never part of the SQL, so it doesn't need escaping.
+ */
+void compile_filter(const filter_expression& filter, string& sql,
+		vector<std::pair<const string*, std::int64_t>>& params)
+{
+	using kind = filter_expression::kind;
+	switch(filter.type)
+	{
+		case kind::all:
+		case kind::any:
+			sql += "(";
+			for(std::size_t i = 0; i < filter.operands.size(); ++i)
+			{
+				if(i > 0)
+					sql += filter.type == kind::all ? " AND " : " OR ";
+				compile_filter(filter.operands[i], sql, params);
+			}
+			sql += ")";
+			break;
+
+		case kind::negation:
+			sql += "NOT ";
+			compile_filter(filter.operands.front(), sql, params);
+			break;
+
+		case kind::rated_since:
+		case kind::rated_before:
+			// A range of the primary key of ratings
+			sql += "EXISTS (SELECT 1 FROM ratings r WHERE r.politician_id = p.id";
+			sql += filter.type == kind::rated_since ? " AND r.date_time >= ?)"
+				: " AND r.date_time < ?)";
+			params.emplace_back(nullptr, filter.number);
+			break;
+
+		case kind::comparison:
+		{
+			static const char* const columns[] = {"p.name_key", "pt.name_key", "p.total_rating",
+				"(SELECT COALESCE(SUM(count), 0) FROM politician_histogram"
+				" WHERE politician_id = p.id)"};
+			static const char* const operators[] = {" = ?", " <> ?", " < ?", " <= ?", " > ?",
+				" >= ?"};
+			sql += columns[static_cast<int>(filter.field)];
+			sql += operators[static_cast<int>(filter.op)];
+			if(filter.field == filter_field::name || filter.field == filter_field::party)
+				params.emplace_back(&filter.text, 0);
+			else
+				params.emplace_back(nullptr, filter.number);
+			break;
+		}
+	}
+}
+
+/**
+ * Steps through the rows of 'stmt', a query of the columns of show_ratings, and
+ * reads them into ratings.
+ */
+vector<rating> read_ratings(const sqlite_stmt_obj& stmt, query_timer& timer, sqlite3* connection)
+{
+	vector<rating> ratings;
+	party_cache parties;
+
+	int ret;
+	while((ret = sqlite3_step(stmt.ppStmt)) == SQLITE_ROW)
+	{
+		string name = (const char*) sqlite3_column_text(stmt.ppStmt, 0);
+		party_handle party = parties.read(stmt.ppStmt, 1);
+		int rating = sqlite3_column_int(stmt.ppStmt, 3);
+		string description = (const char*) sqlite3_column_text(stmt.ppStmt, 4);
+		std::int64_t date_time = sqlite3_column_int64(stmt.ppStmt, 5);
+
+		timer.add_row(name.size() + sizeof(party) + description.size() + sizeof(date_time)
+				+ sizeof(rating));
+		ratings.emplace_back(move(name), party, move(description), rating, date_time);
+	}
+	check_return<db_exception>(
+			ret, SQLITE_DONE, "Search", stmt.function_name, sqlite3_errmsg(connection));
+
+	return ratings;
+}
+
+/**
+ * Steps to the single row of 'stmt', a COUNT(*) or EXISTS query, and reads it.
+ */
+std::int64_t read_count(const sqlite_stmt_obj& stmt, query_timer& timer, sqlite3* connection)
+{
+	int ret = sqlite3_step(stmt.ppStmt);
+	check_return<db_exception>(
+			ret, SQLITE_ROW, "Count", stmt.function_name, sqlite3_errmsg(connection));
+
+	std::int64_t count = sqlite3_column_int64(stmt.ppStmt, 0);
+	timer.add_row(sizeof(count));
+	return count;
+}
+
+/**
+ * Builds the JSON array of the canonical [name, party] keys of 'keys', which the
+ * batch queries bind as a single parameter.
+ */
+string batch_keys_json(const vector<politician_core>& keys)
 {
-	string db_path = check_create_dirs();
-	db_path += DB_FILE;
+	auto append_string = [](string& json, const string& text)
+	{
+		json += '"';
+		for(char c : text)
+		{
+			if(c == '"' || c == '\\')
+			{
+				json += '\\';
+				json += c;
+			}
+			else if(static_cast<unsigned char>(c) < 0x20)
+			{
+				char escaped[8];
+				std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+				json += escaped;
+			}
+			else
+				json += c;
+		}
+		json += '"';
+	};
+
+	string json = "[";
+	for(std::size_t i = 0; i < keys.size(); ++i)
+	{
+		json += i > 0 ? ",[" : "[";
+		append_string(json, canonical_key(keys[i].name));
+		json += ',';
+		append_string(json, keys[i].party.key());
+		json += ']';
+	}
+	json += ']';
+	return json;
+}
+
+database::database()
+	: database(get_db_dir() + DB_FILE)
+{}
 
-	// Initialize the sqlite3 object and create the database file if it doesn't exists.
-	int ret = sqlite3_open(db_path.c_str(), &connection);
+database::database(const string& db_file)
+{
+	// Opening an existing database file is the common case, so the parent directories
+	// and the file itself are only created when opening it fails.
+	int ret;
+	{
+		startup_phase phase("open");
+		ret = sqlite3_open_v2(db_file.c_str(), &connection, SQLITE_OPEN_READWRITE, nullptr);
+	}
+	if(ret == SQLITE_CANTOPEN)
+	{
+		sqlite3_close(connection);
+		{
+			startup_phase phase("directories");
+			create_parent_dirs(db_file);
+		}
+		startup_phase phase("create");
+		ret = sqlite3_open_v2(db_file.c_str(), &connection,
+				SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr);
+	}
 	check_return<db_exception>(ret, SQLITE_OK, "Database opening",
 			"database constructor", sqlite3_errmsg(connection));
 
@@ -42,19 +288,145 @@ database::database()
 			"database constructor", sqlite3_errmsg(connection));
 #endif
 
-	// Create the politician and ratings tables if they don't already exists.
+	// Waits for the locks of other connections, switching to WAL included
+	busy_jitter.seed(static_cast<std::minstd_rand::result_type>(
+			std::chrono::steady_clock::now().time_since_epoch().count()));
+	ret = sqlite3_busy_handler(connection, wait_for_lock, this);
+#ifdef DEBUG
+	check_return<db_exception>(ret, SQLITE_OK, "Set busy handler",
+			"database constructor", sqlite3_errmsg(connection));
+#endif
+
+	// Per-connection settings, which must be applied outside of any transaction
 	char* errmsg;
-	ret = sqlite3_exec(connection, sql_strings::create_tables, nullptr,
+	ret = sqlite3_exec(connection, sql_strings::configure_connection, nullptr,
 			nullptr, &errmsg);
 #ifdef DEBUG
-	check_return<db_exception>(ret, SQLITE_OK, "Create tables",
+	check_return<db_exception>(ret, SQLITE_OK, "Configure connection",
 			"database constructor", errmsg);
 #endif
 	sqlite3_free(errmsg);
+
+	// Lets SQL (the migrations) build the same lookup keys as the C++ code
+	ret = sqlite3_create_function_v2(connection, "canonical_key", 1,
+			SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr, sql_canonical_key, nullptr, nullptr,
+			nullptr);
+	check_return<db_exception>(ret, SQLITE_OK, "Register canonical_key",
+			"database constructor", sqlite3_errmsg(connection));
+
+	startup_phase phase("schema");
+	update_schema();
+}
+
+int database::get_schema_version() const
+{
+	const string function_name = "get_schema_version";
+
+	sqlite_stmt_obj stmt(connection, sql_strings::get_schema_version, function_name);
+
+	int ret = sqlite3_step(stmt.ppStmt);
+	check_return<db_exception>(
+			ret, SQLITE_ROW, "Read", function_name, sqlite3_errmsg(connection));
+
+	return sqlite3_column_int(stmt.ppStmt, 0);
+}
+
+void database::execute(const char* sql, const string& operation,
+		const string& function_name) const
+{
+	char* errmsg;
+	int ret = sqlite3_exec(connection, sql, nullptr, nullptr, &errmsg);
+	if(ret != SQLITE_OK)
+	{
+		db_exception e(operation, function_name, ret, errmsg);
+		sqlite3_free(errmsg);
+		throw e;
+	}
+}
+
+void database::update_schema() const
+{
+	const string function_name = "update_schema";
+
+	// Fast path: the schema is already up to date, which only costs reading the header
+	int version = get_schema_version();
+	if(version == sql_strings::schema_version)
+		return;
+
+	// Whether there were tables to upgrade, rather than a new file being set up
+	const bool upgraded = version > 0;
+
+	// Migrations rebuild tables, which must not cascade to the tables referencing
+	// them. Foreign keys can only be switched off outside of a transaction.
+	execute("PRAGMA foreign_keys = OFF;", "Disable foreign keys", function_name);
+	try
+	{
+		db_transaction transaction(*this, "BEGIN IMMEDIATE;");
+
+		// Another process may have updated the schema while we waited for the lock
+		version = get_schema_version();
+		if(version > sql_strings::schema_version)
+			throw db_exception("The database file was created by a newer version of "
+					"this program (schema version " + std::to_string(version) + ").");
+
+		for(; version < sql_strings::schema_version; ++version)
+		{
+			if(sql_strings::migrations[version] == sql_strings::add_lookup_keys)
+				check_lookup_keys();
+			execute(sql_strings::migrations[version], "Migrate schema", function_name);
+		}
+
+		sqlite_stmt_obj check_stmt(connection, sql_strings::check_foreign_keys, function_name);
+		if(sqlite3_step(check_stmt.ppStmt) != SQLITE_DONE)
+			throw db_exception("Schema migration left rows with invalid foreign keys.");
+
+		string set_version = "PRAGMA user_version = "
+			+ std::to_string(sql_strings::schema_version) + ";";
+		execute(set_version.c_str(), "Set schema version", function_name);
+		transaction.commit();
+	}
+	catch(...)
+	{
+		sqlite3_exec(connection, sql_strings::configure_connection, nullptr, nullptr, nullptr);
+		throw;
+	}
+	execute(sql_strings::configure_connection, "Configure connection", function_name);
+
+	// Rebuilt tables leave their old pages free inside the file, give them back
+	if(upgraded)
+		execute("VACUUM;", "Vacuum", function_name);
+}
+
+void database::check_lookup_keys() const
+{
+	const string function_name = "check_lookup_keys";
+
+	sqlite_stmt_obj stmt(connection, sql_strings::lookup_key_collisions, function_name);
+	string collisions;
+	int ret;
+	while((ret = sqlite3_step(stmt.ppStmt)) == SQLITE_ROW)
+	{
+		collisions += "\n  '";
+		collisions += reinterpret_cast<const char*>(sqlite3_column_text(stmt.ppStmt, 0));
+		collisions += "' (";
+		collisions += reinterpret_cast<const char*>(sqlite3_column_text(stmt.ppStmt, 1));
+		collisions += ')';
+	}
+	check_return<db_exception>(
+			ret, SQLITE_DONE, "Read", function_name, sqlite3_errmsg(connection));
+
+	if(!collisions.empty())
+		throw db_exception("The database can't be upgraded: these politicians of the same "
+				"party have names that only differ by accents or case, which are no longer "
+				"told apart. Rename or delete all but one of each (e.g. with the sqlite3 "
+				"shell) and try again:" + collisions);
 }
 
 database::~database()
 {
+	for(auto& [query, stmt] : statement_cache)
+		sqlite3_finalize(stmt);
+
 	int ret = sqlite3_close(connection);
 	if(ret != SQLITE_OK)
 	{
@@ -63,22 +435,75 @@ database::~database()
 	}
 }
 
+sqlite3_int64 database::get_party_id(const party_handle& party, bool create) const
+{
+	const string function_name = "get_party_id";
+
+	sqlite_stmt_obj stmt(*this, sql_strings::search_party_id, function_name);
+
+	int ret = sqlite3_bind_text(stmt.ppStmt, 1, party.key().c_str(), -1, SQLITE_STATIC);
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind party key", function_name, sqlite3_errmsg(connection));
+#endif
+
+	ret = sqlite3_step(stmt.ppStmt);
+	if(ret == SQLITE_ROW)
+		return sqlite3_column_int64(stmt.ppStmt, 0);
+	check_return<db_exception>(
+			ret, SQLITE_DONE, "Search", function_name, sqlite3_errmsg(connection));
+
+	if(!create)
+		return 0;
+
+	sqlite_stmt_obj insert_stmt(*this, sql_strings::insert_to_party, function_name);
+
+	ret = sqlite3_bind_text(insert_stmt.ppStmt, 1, party.c_str(), -1, SQLITE_STATIC);
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind party", function_name, sqlite3_errmsg(connection));
+#endif
+
+	ret = sqlite3_bind_text(insert_stmt.ppStmt, 2, party.key().c_str(), -1, SQLITE_STATIC);
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind party key", function_name, sqlite3_errmsg(connection));
+#endif
+
+	ret = sqlite3_step(insert_stmt.ppStmt);
+	check_return<db_exception>(
+			ret, SQLITE_DONE, "Insert", function_name, sqlite3_errmsg(connection));
+
+	return sqlite3_last_insert_rowid(connection);
+}
+
 int database::insert_to_politician(const politician& p) const
 {
 	const string function_name = "insert_to_politician";
+	static query_counters counters(__func__);
+	query_timer timer(counters);
 
-	sqlite_stmt_obj stmt(connection, sql_strings::insert_to_politician, function_name);
+	const string name_key = canonical_key(p.name);
 
+	// The party is created along with its first politician. The write lock is taken
+	// upfront: a read transaction upgraded to a write one fails at once, without
+	// waiting, if another connection wrote in between
+	db_transaction transaction(*this, "BEGIN IMMEDIATE;");
+	sqlite3_int64 party_id = get_party_id(p.party, true);
+
+	sqlite_stmt_obj stmt(*this, sql_strings::insert_to_politician, function_name);
+
+	trace_span span("bind");
 	int ret = sqlite3_bind_text(stmt.ppStmt, 1, p.name.c_str(), -1, SQLITE_STATIC);
 #ifdef DEBUG
 	check_return<db_exception>(
 			ret, SQLITE_OK, "Bind name", function_name, sqlite3_errmsg(connection));
 #endif
 
-	ret = sqlite3_bind_text(stmt.ppStmt, 2, p.party.c_str(), -1, SQLITE_STATIC);
+	ret = sqlite3_bind_int64(stmt.ppStmt, 2, party_id);
 #ifdef DEBUG
 	check_return<db_exception>(
-			ret, SQLITE_OK, "Bind party", function_name, sqlite3_errmsg(connection));
+			ret, SQLITE_OK, "Bind party id", function_name, sqlite3_errmsg(connection));
 #endif
 
 	ret = sqlite3_bind_text(stmt.ppStmt, 3, p.info.c_str(), -1, SQLITE_STATIC);
@@ -87,29 +512,44 @@ int database::insert_to_politician(const politician& p) const
 			ret, SQLITE_OK, "Bind info", function_name, sqlite3_errmsg(connection));
 #endif
 
+	ret = sqlite3_bind_text(stmt.ppStmt, 4, name_key.c_str(), -1, SQLITE_STATIC);
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind name key", function_name, sqlite3_errmsg(connection));
+#endif
+
+	span.next("step");
 	ret = sqlite3_step(stmt.ppStmt);
 	check_return<politician_op_exception>(
 			ret, SQLITE_DONE, "Insert", function_name, sqlite3_errmsg(connection));
 
-	return sqlite3_changes(connection);
+	int changes = sqlite3_changes(connection);
+	transaction.commit();
+	timer.add_rows(changes);
+	return changes;
 }
 
 int database::insert_to_ratings(const rating& r) const
 {
 	const string function_name = "insert_to_ratings";
+	static query_counters counters(__func__);
+	query_timer timer(counters);
+
+	const string name_key = canonical_key(r.name);
 
-	sqlite_stmt_obj stmt(connection, sql_strings::insert_to_ratings, function_name);
+	sqlite_stmt_obj stmt(*this, sql_strings::insert_to_ratings, function_name);
 
-	int ret = sqlite3_bind_text(stmt.ppStmt, 1, r.name.c_str(), -1, SQLITE_STATIC);
+	trace_span span("bind");
+	int ret = sqlite3_bind_text(stmt.ppStmt, 1, name_key.c_str(), -1, SQLITE_STATIC);
 #ifdef DEBUG
 	check_return<db_exception>(
-			ret, SQLITE_OK, "Bind name", function_name, sqlite3_errmsg(connection));
+			ret, SQLITE_OK, "Bind name key", function_name, sqlite3_errmsg(connection));
 #endif
 
-	ret = sqlite3_bind_text(stmt.ppStmt, 2, r.party.c_str(), -1, SQLITE_STATIC);
+	ret = sqlite3_bind_text(stmt.ppStmt, 2, r.party.key().c_str(), -1, SQLITE_STATIC);
 #ifdef DEBUG
 	check_return<db_exception>(
-			ret, SQLITE_OK, "Bind party", function_name, sqlite3_errmsg(connection));
+			ret, SQLITE_OK, "Bind party key", function_name, sqlite3_errmsg(connection));
 #endif
 
 	ret = sqlite3_bind_int(stmt.ppStmt, 3, r.points);
@@ -124,91 +564,134 @@ int database::insert_to_ratings(const rating& r) const
 			ret, SQLITE_OK, "Bind description", function_name, sqlite3_errmsg(connection));
 #endif
 
+	// Timestamped here rather than by SQL, which has millisecond resolution at best
+	ret = sqlite3_bind_int64(stmt.ppStmt, 5, r.date_time != 0 ? r.date_time : timestamp::now());
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind date/time", function_name, sqlite3_errmsg(connection));
+#endif
+
+	span.next("step");
 	ret = sqlite3_step(stmt.ppStmt);
 	check_return<rating_op_exception>(
 			ret, SQLITE_DONE, "Insert", function_name, sqlite3_errmsg(connection));
 
-	return sqlite3_changes(connection);
+	// The rating is inserted by selecting its politician, so no row means no politician
+	int changes = sqlite3_changes(connection);
+	if(changes == 0)
+		throw rating_op_exception("Insert", function_name, SQLITE_CONSTRAINT_FOREIGNKEY, nullptr);
+	timer.add_rows(changes);
+	return changes;
 }
 
 int database::update_party(const politician_update& p) const
 {
 	const string function_name = "update_party";
+	static query_counters counters(__func__);
+	query_timer timer(counters);
+
+	const string name_key = canonical_key(p.name);
+
+	// The new party may need to be created, which is undone if no politician moves to it
+	db_transaction transaction(*this, "BEGIN IMMEDIATE;");
+	sqlite3_int64 new_party_id = get_party_id(p.new_party, true);
 
-	sqlite_stmt_obj stmt(connection, sql_strings::update_party, function_name);
+	sqlite_stmt_obj stmt(*this, sql_strings::update_party, function_name);
 
-	int ret = sqlite3_bind_text(stmt.ppStmt, 1, p.new_party.c_str(), -1, SQLITE_STATIC);
+	trace_span span("bind");
+	int ret = sqlite3_bind_int64(stmt.ppStmt, 1, new_party_id);
 #ifdef DEBUG
 	check_return<db_exception>(
-			ret, SQLITE_OK, "Bind new party", function_name, sqlite3_errmsg(connection));
+			ret, SQLITE_OK, "Bind new party id", function_name, sqlite3_errmsg(connection));
 #endif
 
-	ret = sqlite3_bind_text(stmt.ppStmt, 2, p.name.c_str(), -1, SQLITE_STATIC);
+	ret = sqlite3_bind_text(stmt.ppStmt, 2, name_key.c_str(), -1, SQLITE_STATIC);
 #ifdef DEBUG
 	check_return<db_exception>(
-			ret, SQLITE_OK, "Bind name", function_name, sqlite3_errmsg(connection));
+			ret, SQLITE_OK, "Bind name key", function_name, sqlite3_errmsg(connection));
 #endif
 
-	ret = sqlite3_bind_text(stmt.ppStmt, 3, p.party.c_str(), -1, SQLITE_STATIC);
+	ret = sqlite3_bind_text(stmt.ppStmt, 3, p.party.key().c_str(), -1, SQLITE_STATIC);
 #ifdef DEBUG
 	check_return<db_exception>(
-			ret, SQLITE_OK, "Bind party", function_name, sqlite3_errmsg(connection));
+			ret, SQLITE_OK, "Bind party key", function_name, sqlite3_errmsg(connection));
 #endif
 
+	span.next("step");
 	ret = sqlite3_step(stmt.ppStmt);
-	check_return<db_exception>(
+	check_return<politician_op_exception>(
 			ret, SQLITE_DONE, "Update", function_name, sqlite3_errmsg(connection));
 
-	return sqlite3_changes(connection);
+	int changes = sqlite3_changes(connection);
+	if(changes > 0)
+		transaction.commit();
+	timer.add_rows(changes);
+	return changes;
 }
 
 int database::delete_politician(const politician_core& p) const
 {
 	const string function_name = "delete_politician";
+	static query_counters counters(__func__);
+	query_timer timer(counters);
 
-	sqlite_stmt_obj stmt(connection, sql_strings::delete_politician, function_name);
+	const string name_key = canonical_key(p.name);
 
-	int ret = sqlite3_bind_text(stmt.ppStmt, 1, p.name.c_str(), -1, SQLITE_STATIC);
+	sqlite_stmt_obj stmt(*this, sql_strings::delete_politician, function_name);
+
+	trace_span span("bind");
+	int ret = sqlite3_bind_text(stmt.ppStmt, 1, name_key.c_str(), -1, SQLITE_STATIC);
 #ifdef DEBUG
 	check_return<db_exception>(
-			ret, SQLITE_OK, "Bind name", function_name, sqlite3_errmsg(connection));
+			ret, SQLITE_OK, "Bind name key", function_name, sqlite3_errmsg(connection));
 #endif
 
-	ret = sqlite3_bind_text(stmt.ppStmt, 2, p.party.c_str(), -1, SQLITE_STATIC);
+	ret = sqlite3_bind_text(stmt.ppStmt, 2, p.party.key().c_str(), -1, SQLITE_STATIC);
 #ifdef DEBUG
 	check_return<db_exception>(
-			ret, SQLITE_OK, "Bind party", function_name, sqlite3_errmsg(connection));
+			ret, SQLITE_OK, "Bind party key", function_name, sqlite3_errmsg(connection));
 #endif
 
+	span.next("step");
 	ret = sqlite3_step(stmt.ppStmt);
 	check_return<politician_op_exception>(
 			ret, SQLITE_DONE, "Delete", function_name, sqlite3_errmsg(connection));
 
-	return sqlite3_changes(connection);
+	int changes = sqlite3_changes(connection);
+	timer.add_rows(changes);
+	return changes;
 }
 
 const vector<politician> database::get_politician_by_name(const string& name) const
 {
 	const string function_name = "get_politician_by_name";
+	static query_counters counters(__func__);
+	query_timer timer(counters);
 
-	sqlite_stmt_obj stmt(connection, sql_strings::search_by_name, function_name);
+	const string name_key = canonical_key(name);
+
+	sqlite_stmt_obj stmt(*this, sql_strings::search_by_name, function_name);
 
 	vector<politician> politicians;
+	party_cache parties;
 
-	int ret = sqlite3_bind_text(stmt.ppStmt, 1, name.c_str(), -1, SQLITE_STATIC);
+	trace_span span("bind");
+	int ret = sqlite3_bind_text(stmt.ppStmt, 1, name_key.c_str(), -1, SQLITE_STATIC);
 #ifdef DEBUG
 	check_return<db_exception>(
-			ret, SQLITE_OK, "Bind name", function_name, sqlite3_errmsg(connection));
+			ret, SQLITE_OK, "Bind name key", function_name, sqlite3_errmsg(connection));
 #endif
 
+	span.next("step");
 	while((ret = sqlite3_step(stmt.ppStmt)) == SQLITE_ROW)
 	{
 		string name = (const char*) sqlite3_column_text(stmt.ppStmt, 0);
-		string party = (const char*) sqlite3_column_text(stmt.ppStmt, 1);
-		string info = (const char*) sqlite3_column_text(stmt.ppStmt, 2);
-		int rating = sqlite3_column_int(stmt.ppStmt, 3);
+		party_handle party = parties.read(stmt.ppStmt, 1);
+		string info = (const char*) sqlite3_column_text(stmt.ppStmt, 3);
+		int rating = sqlite3_column_int(stmt.ppStmt, 4);
 
-		politicians.emplace_back(move(name), move(party), move(info), rating);
+		timer.add_row(name.size() + sizeof(party) + info.size() + sizeof(rating));
+		politicians.emplace_back(move(name), party, move(info), rating);
 	}
 	check_return<db_exception>(
 			ret, SQLITE_DONE, "Search", function_name, sqlite3_errmsg(connection));
@@ -219,25 +702,33 @@ const vector<politician> database::get_politician_by_name(const string& name) co
 const vector<politician> database::get_politicians_by_party(const string& party) const
 {
 	const string function_name = "get_politicians_by_party";
+	static query_counters counters(__func__);
+	query_timer timer(counters);
+
+	const string party_key = canonical_key(party);
 
-	sqlite_stmt_obj stmt(connection, sql_strings::search_by_party, function_name);
+	sqlite_stmt_obj stmt(*this, sql_strings::search_by_party, function_name);
 
 	vector<politician> politicians;
+	party_cache parties;
 
-	int ret = sqlite3_bind_text(stmt.ppStmt, 1, party.c_str(), -1, SQLITE_STATIC);
+	trace_span span("bind");
+	int ret = sqlite3_bind_text(stmt.ppStmt, 1, party_key.c_str(), -1, SQLITE_STATIC);
 #ifdef DEBUG
 	check_return<db_exception>(
-			ret, SQLITE_OK, "Bind party", function_name, sqlite3_errmsg(connection));
+			ret, SQLITE_OK, "Bind party key", function_name, sqlite3_errmsg(connection));
 #endif
 
+	span.next("step");
 	while((ret = sqlite3_step(stmt.ppStmt)) == SQLITE_ROW)
 	{
 		string name = (const char*) sqlite3_column_text(stmt.ppStmt, 0);
-		string party = (const char*) sqlite3_column_text(stmt.ppStmt, 1);
-		string info = (const char*) sqlite3_column_text(stmt.ppStmt, 2);
-		int rating = sqlite3_column_int(stmt.ppStmt, 3);
+		party_handle party = parties.read(stmt.ppStmt, 1);
+		string info = (const char*) sqlite3_column_text(stmt.ppStmt, 3);
+		int rating = sqlite3_column_int(stmt.ppStmt, 4);
 
-		politicians.emplace_back(move(name), move(party), move(info), rating);
+		timer.add_row(name.size() + sizeof(party) + info.size() + sizeof(rating));
+		politicians.emplace_back(move(name), party, move(info), rating);
 	}
 	check_return<db_exception>(
 			ret, SQLITE_DONE, "Search", function_name, sqlite3_errmsg(connection));
@@ -248,32 +739,108 @@ const vector<politician> database::get_politicians_by_party(const string& party)
 const vector<rating> database::get_politician_ratings(const politician_core& p) const
 {
 	const string function_name = "get_politician_ratings";
+	static query_counters counters(__func__);
+	query_timer timer(counters);
 
-	sqlite_stmt_obj stmt(connection, sql_strings::show_ratings, function_name);
+	const string name_key = canonical_key(p.name);
 
-	vector<rating> ratings;
+	sqlite_stmt_obj stmt(*this, sql_strings::show_ratings, function_name);
 
-	int ret = sqlite3_bind_text(stmt.ppStmt, 1, p.name.c_str(), -1, SQLITE_STATIC);
+	trace_span span("bind");
+	[[maybe_unused]] int ret = sqlite3_bind_text(stmt.ppStmt, 1, name_key.c_str(), -1,
+			SQLITE_STATIC);
 #ifdef DEBUG
 	check_return<db_exception>(
-			ret, SQLITE_OK, "Bind name", function_name, sqlite3_errmsg(connection));
+			ret, SQLITE_OK, "Bind name key", function_name, sqlite3_errmsg(connection));
 #endif
 
-	ret = sqlite3_bind_text(stmt.ppStmt, 2, p.party.c_str(), -1, SQLITE_STATIC);
+	ret = sqlite3_bind_text(stmt.ppStmt, 2, p.party.key().c_str(), -1, SQLITE_STATIC);
 #ifdef DEBUG
 	check_return<db_exception>(
-			ret, SQLITE_OK, "Bind party", function_name, sqlite3_errmsg(connection));
+			ret, SQLITE_OK, "Bind party key", function_name, sqlite3_errmsg(connection));
+#endif
+
+	span.next("step");
+	return read_ratings(stmt, timer, connection);
+}
+
+const vector<std::optional<politician>> database::get_politicians_batch(
+		const vector<politician_core>& keys) const
+{
+	const string function_name = "get_politicians_batch";
+	static query_counters counters(__func__);
+	query_timer timer(counters);
+
+	const string json_keys = batch_keys_json(keys);
+
+	sqlite_stmt_obj stmt(*this, sql_strings::search_politicians_batch, function_name);
+
+	trace_span span("bind");
+	int ret = sqlite3_bind_text(stmt.ppStmt, 1, json_keys.c_str(),
+			static_cast<int>(json_keys.size()), SQLITE_STATIC);
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind keys", function_name, sqlite3_errmsg(connection));
 #endif
 
+	vector<std::optional<politician>> politicians(keys.size());
+	party_cache parties;
+
+	span.next("step");
 	while((ret = sqlite3_step(stmt.ppStmt)) == SQLITE_ROW)
 	{
 		string name = (const char*) sqlite3_column_text(stmt.ppStmt, 0);
-		string party = (const char*) sqlite3_column_text(stmt.ppStmt, 1);
-		int rating = sqlite3_column_int(stmt.ppStmt, 2);
-		string description = (const char*) sqlite3_column_text(stmt.ppStmt, 3);
-		string date_time = (const char*) sqlite3_column_text(stmt.ppStmt, 4);
+		party_handle party = parties.read(stmt.ppStmt, 1);
+		string info = (const char*) sqlite3_column_text(stmt.ppStmt, 3);
+		int rating = sqlite3_column_int(stmt.ppStmt, 4);
+		// Index of the key in the JSON array
+		std::size_t key = static_cast<std::size_t>(sqlite3_column_int64(stmt.ppStmt, 5));
+
+		timer.add_row(name.size() + sizeof(party) + info.size() + sizeof(rating));
+		politicians[key].emplace(move(name), party, move(info), rating);
+	}
+	check_return<db_exception>(
+			ret, SQLITE_DONE, "Search", function_name, sqlite3_errmsg(connection));
+
+	return politicians;
+}
+
+const vector<vector<rating>> database::get_ratings_batch(
+		const vector<politician_core>& keys) const
+{
+	const string function_name = "get_ratings_batch";
+	static query_counters counters(__func__);
+	query_timer timer(counters);
+
+	const string json_keys = batch_keys_json(keys);
+
+	sqlite_stmt_obj stmt(*this, sql_strings::show_ratings_batch, function_name);
+
+	trace_span span("bind");
+	int ret = sqlite3_bind_text(stmt.ppStmt, 1, json_keys.c_str(),
+			static_cast<int>(json_keys.size()), SQLITE_STATIC);
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind keys", function_name, sqlite3_errmsg(connection));
+#endif
+
+	vector<vector<rating>> ratings(keys.size());
+	party_cache parties;
 
-		ratings.emplace_back(move(name), move(party), move(description), rating, move(date_time));
+	span.next("step");
+	while((ret = sqlite3_step(stmt.ppStmt)) == SQLITE_ROW)
+	{
+		string name = (const char*) sqlite3_column_text(stmt.ppStmt, 0);
+		party_handle party = parties.read(stmt.ppStmt, 1);
+		int rating = sqlite3_column_int(stmt.ppStmt, 3);
+		string description = (const char*) sqlite3_column_text(stmt.ppStmt, 4);
+		std::int64_t date_time = sqlite3_column_int64(stmt.ppStmt, 5);
+		// Index of the key in the JSON array
+		std::size_t key = static_cast<std::size_t>(sqlite3_column_int64(stmt.ppStmt, 6));
+
+		timer.add_row(name.size() + sizeof(party) + description.size() + sizeof(date_time)
+				+ sizeof(rating));
+		ratings[key].emplace_back(move(name), party, move(description), rating, date_time);
 	}
 	check_return<db_exception>(
 			ret, SQLITE_DONE, "Search", function_name, sqlite3_errmsg(connection));
@@ -281,31 +848,120 @@ const vector<rating> database::get_politician_ratings(const politician_core& p)
 	return ratings;
 }
 
+const vector<rating> database::get_ratings_in_range(const politician_core& p,
+		const rating_range& range) const
+{
+	const string function_name = "get_ratings_in_range";
+	static query_counters counters(__func__);
+	query_timer timer(counters);
+
+	const string name_key = canonical_key(p.name);
+
+	// A static query per order, so that both stay in the statement cache
+	sqlite_stmt_obj stmt(*this, range.descending ? sql_strings::show_ratings_in_range_desc
+			: sql_strings::show_ratings_in_range_asc, function_name);
+
+	trace_span span("bind");
+	[[maybe_unused]] int ret = sqlite3_bind_text(stmt.ppStmt, 1, name_key.c_str(), -1,
+			SQLITE_STATIC);
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind name key", function_name, sqlite3_errmsg(connection));
+#endif
+
+	ret = sqlite3_bind_text(stmt.ppStmt, 2, p.party.key().c_str(), -1, SQLITE_STATIC);
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind party key", function_name, sqlite3_errmsg(connection));
+#endif
+
+	ret = sqlite3_bind_int64(stmt.ppStmt, 3, range.from);
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind range start", function_name, sqlite3_errmsg(connection));
+#endif
+
+	ret = sqlite3_bind_int64(stmt.ppStmt, 4, range.to);
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind range end", function_name, sqlite3_errmsg(connection));
+#endif
+
+	// A negative LIMIT is no limit
+	ret = sqlite3_bind_int64(stmt.ppStmt, 5,
+			range.limit == 0 ? -1 : static_cast<sqlite3_int64>(range.limit));
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind limit", function_name, sqlite3_errmsg(connection));
+#endif
+
+	span.next("step");
+	return read_ratings(stmt, timer, connection);
+}
+
+const vector<rating> database::get_all_ratings_in_range(const rating_range& range) const
+{
+	const string function_name = "get_all_ratings_in_range";
+	static query_counters counters(__func__);
+	query_timer timer(counters);
+
+	sqlite_stmt_obj stmt(*this, range.descending ? sql_strings::show_all_ratings_in_range_desc
+			: sql_strings::show_all_ratings_in_range_asc, function_name);
+
+	trace_span span("bind");
+	[[maybe_unused]] int ret = sqlite3_bind_int64(stmt.ppStmt, 1, range.from);
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind range start", function_name, sqlite3_errmsg(connection));
+#endif
+
+	ret = sqlite3_bind_int64(stmt.ppStmt, 2, range.to);
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind range end", function_name, sqlite3_errmsg(connection));
+#endif
+
+	ret = sqlite3_bind_int64(stmt.ppStmt, 3,
+			range.limit == 0 ? -1 : static_cast<sqlite3_int64>(range.limit));
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind limit", function_name, sqlite3_errmsg(connection));
+#endif
+
+	span.next("step");
+	return read_ratings(stmt, timer, connection);
+}
+
 const vector<politician> database::get_all_politicians(const string& order) const
 {
 	const string function_name = "get_all_politicians";
+	static query_counters counters(__func__);
+	query_timer timer(counters);
 
 	if(order != "ASC" && order != "DESC")
 		throw std::domain_error(
 				"'order' parameter of function '" + function_name + "' not satisfed.\n"
 				"Expected: [DESC | ASC]. Got: " + order);
 
-	char sql_query[100];
-	std::sprintf(sql_query, sql_strings::show_politicians, order.c_str());
+	char sql_query[300];
+	std::snprintf(sql_query, sizeof(sql_query), sql_strings::show_politicians, order.c_str());
 
 	sqlite_stmt_obj stmt(connection, sql_query, function_name);
 
 	vector<politician> politicians;
+	party_cache parties;
 
+	trace_span span("step");
 	int ret;
 	while((ret = sqlite3_step(stmt.ppStmt)) == SQLITE_ROW)
 	{
 		string name = (const char*) sqlite3_column_text(stmt.ppStmt, 0);
-		string party = (const char*) sqlite3_column_text(stmt.ppStmt, 1);
-		string info = (const char*) sqlite3_column_text(stmt.ppStmt, 2);
-		int rating = sqlite3_column_int(stmt.ppStmt, 3);
+		party_handle party = parties.read(stmt.ppStmt, 1);
+		string info = (const char*) sqlite3_column_text(stmt.ppStmt, 3);
+		int rating = sqlite3_column_int(stmt.ppStmt, 4);
 
-		politicians.emplace_back(move(name), move(party), move(info), rating);
+		timer.add_row(name.size() + sizeof(party) + info.size() + sizeof(rating));
+		politicians.emplace_back(move(name), party, move(info), rating);
 	}
 	check_return<db_exception>(
 			ret, SQLITE_DONE, "Search", function_name, sqlite3_errmsg(connection));
@@ -316,26 +972,32 @@ const vector<politician> database::get_all_politicians(const string& order) cons
 const vector<politician_core> database::get_politicians_compact(const string& order) const
 {
 	const string function_name = "get_politicians_compact";
+	static query_counters counters(__func__);
+	query_timer timer(counters);
 
 	if(order != "ASC" && order != "DESC")
 		throw std::domain_error(
 				"'order' parameter of function '" + function_name + "' not satisfed.\n"
 				"Expected: [DESC | ASC]. Got: " + order);
 
-	char sql_query[100];
-	std::sprintf(sql_query, sql_strings::show_politicians_compact, order.c_str());
+	char sql_query[300];
+	std::snprintf(sql_query, sizeof(sql_query), sql_strings::show_politicians_compact,
+			order.c_str());
 
 	sqlite_stmt_obj stmt(connection, sql_query, function_name);
 
 	vector<politician_core> politicians;
+	party_cache parties;
 
+	trace_span span("step");
 	int ret;
 	while((ret = sqlite3_step(stmt.ppStmt)) == SQLITE_ROW)
 	{
 		string name = (const char*) sqlite3_column_text(stmt.ppStmt, 0);
-		string party = (const char*) sqlite3_column_text(stmt.ppStmt, 1);
+		party_handle party = parties.read(stmt.ppStmt, 1);
 
-		politicians.emplace_back(move(name), move(party));
+		timer.add_row(name.size() + sizeof(party));
+		politicians.emplace_back(move(name), party);
 	}
 	check_return<db_exception>(
 			ret, SQLITE_DONE, "Search", function_name, sqlite3_errmsg(connection));
@@ -343,14 +1005,614 @@ const vector<politician_core> database::get_politicians_compact(const string& or
 	return politicians;
 }
 
-const string database::DB_FILE("data.db");
+void database::for_each_politician_with_ratings(std::size_t latest, const string& order,
+		const politician_visitor& visit) const
+{
+	const string function_name = "for_each_politician_with_ratings";
+	static query_counters counters(__func__);
+	query_timer timer(counters);
 
-const string database::DB_PATH("/.local/share/politician/");
+	if(order != "ASC" && order != "DESC")
+		throw std::domain_error(
+				"'order' parameter of function '" + function_name + "' not satisfed.\n"
+				"Expected: [DESC | ASC]. Got: " + order);
 
-sqlite_stmt_obj::sqlite_stmt_obj(sqlite3* connection, const char* query,
+	char sql_query[800];
+	std::snprintf(sql_query, sizeof(sql_query), sql_strings::show_politicians_with_ratings,
+			order.c_str());
+
+	sqlite_stmt_obj stmt(connection, sql_query, function_name);
+
+	trace_span span("bind");
+	[[maybe_unused]] int ret = sqlite3_bind_int64(stmt.ppStmt, 1,
+			static_cast<sqlite3_int64>(latest));
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind latest", function_name, sqlite3_errmsg(connection));
+#endif
+
+	ret = sqlite3_bind_int64(stmt.ppStmt, 2, std::numeric_limits<sqlite3_int64>::min());
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind earliest", function_name, sqlite3_errmsg(connection));
+#endif
+
+	// The rows of a politician are consecutive: the politician is visited when the
+	// next one starts
+	std::optional<politician> current;
+	sqlite3_int64 current_id = 0;
+	vector<rating> ratings;
+	party_cache parties;
+
+	span.next("step");
+	while((ret = sqlite3_step(stmt.ppStmt)) == SQLITE_ROW)
+	{
+		sqlite3_int64 id = sqlite3_column_int64(stmt.ppStmt, 0);
+		if(!current || id != current_id)
+		{
+			if(current)
+				visit(*current, ratings);
+			ratings.clear();
+
+			string name = (const char*) sqlite3_column_text(stmt.ppStmt, 1);
+			party_handle party = parties.read(stmt.ppStmt, 2);
+			string info = (const char*) sqlite3_column_text(stmt.ppStmt, 4);
+			int rating = sqlite3_column_int(stmt.ppStmt, 5);
+
+			timer.add_row(name.size() + sizeof(party) + info.size() + sizeof(rating));
+			current.emplace(move(name), party, move(info), rating);
+			current_id = id;
+		}
+
+		// A politician without ratings has a single row, without a rating
+		if(sqlite3_column_type(stmt.ppStmt, 8) == SQLITE_NULL)
+			continue;
+		int rating = sqlite3_column_int(stmt.ppStmt, 6);
+		string description = (const char*) sqlite3_column_text(stmt.ppStmt, 7);
+		std::int64_t date_time = sqlite3_column_int64(stmt.ppStmt, 8);
+
+		timer.add_row(description.size() + sizeof(date_time) + sizeof(rating));
+		ratings.emplace_back(current->name, current->party, move(description), rating,
+				date_time);
+	}
+	check_return<db_exception>(
+			ret, SQLITE_DONE, "Search", function_name, sqlite3_errmsg(connection));
+
+	if(current)
+		visit(*current, ratings);
+}
+
+const vector<projected_politician> database::get_politicians_projected(
+		const vector<politician_field>& fields, const string& order) const
+{
+	const string function_name = "get_politicians_projected";
+	static query_counters counters(__func__);
+	query_timer timer(counters);
+
+	if(order != "ASC" && order != "DESC")
+		throw std::domain_error(
+				"'order' parameter of function '" + function_name + "' not satisfed.\n"
+				"Expected: [DESC | ASC]. Got: " + order);
+
+	string columns;
+	for(politician_field field : fields)
+	{
+		if(!columns.empty())
+			columns += ", ";
+		switch(field)
+		{
+			case politician_field::name:
+				columns += "p.name";
+				break;
+			case politician_field::party:
+				columns += "pt.id, pt.name";
+				break;
+			case politician_field::information:
+				columns += "p.information";
+				break;
+			case politician_field::points:
+				columns += "p.total_rating";
+				break;
+			case politician_field::ratings:
+				columns += sql_strings::count_ratings;
+				break;
+		}
+	}
+	if(columns.empty())
+		columns = "NULL";
+
+	// The SELECT list grows with the fields, so the query is sized to hold it
+	string sql_query(std::strlen(sql_strings::show_politicians_projected) + columns.size()
+			+ order.size(), '\0');
+	sql_query.resize(static_cast<std::size_t>(std::snprintf(&sql_query[0], sql_query.size(),
+			sql_strings::show_politicians_projected, columns.c_str(), order.c_str())));
+
+	sqlite_stmt_obj stmt(connection, sql_query.c_str(), function_name);
+
+	vector<projected_politician> politicians;
+	party_cache parties;
+
+	trace_span span("step");
+	int ret;
+	while((ret = sqlite3_step(stmt.ppStmt)) == SQLITE_ROW)
+	{
+		projected_politician& p = politicians.emplace_back();
+		std::size_t size = 0;
+		int column = 0;
+		for(politician_field field : fields)
+		{
+			switch(field)
+			{
+				case politician_field::name:
+					p.name = (const char*) sqlite3_column_text(stmt.ppStmt, column++);
+					size += p.name.size();
+					break;
+				case politician_field::party:
+					p.party = parties.read(stmt.ppStmt, column);
+					column += 2;
+					size += sizeof(party_handle);
+					break;
+				case politician_field::information:
+					p.info = (const char*) sqlite3_column_text(stmt.ppStmt, column++);
+					size += p.info.size();
+					break;
+				case politician_field::points:
+					p.points = sqlite3_column_int64(stmt.ppStmt, column++);
+					size += sizeof(p.points);
+					break;
+				case politician_field::ratings:
+					p.ratings = sqlite3_column_int64(stmt.ppStmt, column++);
+					size += sizeof(p.ratings);
+					break;
+			}
+		}
+		timer.add_row(size);
+	}
+	check_return<db_exception>(
+			ret, SQLITE_DONE, "Search", function_name, sqlite3_errmsg(connection));
+
+	return politicians;
+}
+
+const vector<politician> database::get_politicians_where(
+		const filter_expression& filter) const
+{
+	const string function_name = "get_politicians_where";
+	static query_counters counters(__func__);
+	query_timer timer(counters);
+
+	string condition;
+	vector<std::pair<const string*, std::int64_t>> params;
+	compile_filter(filter, condition, params);
+
+	const string sql_query = string(sql_strings::search_where) + condition
+		+ " ORDER BY p.total_rating DESC, p.name ASC, pt.name ASC;";
+	sqlite_stmt_obj stmt(connection, sql_query.c_str(), function_name);
+
+	trace_span span("bind");
+	int ret;
+	for(std::size_t i = 0; i < params.size(); ++i)
+	{
+		const int index = static_cast<int>(i) + 1;
+		if(params[i].first != nullptr)
+			ret = sqlite3_bind_text(stmt.ppStmt, index, params[i].first->c_str(), -1,
+					SQLITE_STATIC);
+		else
+			ret = sqlite3_bind_int64(stmt.ppStmt, index, params[i].second);
+#ifdef DEBUG
+		check_return<db_exception>(
+				ret, SQLITE_OK, "Bind filter value", function_name, sqlite3_errmsg(connection));
+#endif
+	}
+
+	vector<politician> politicians;
+	party_cache parties;
+
+	span.next("step");
+	while((ret = sqlite3_step(stmt.ppStmt)) == SQLITE_ROW)
+	{
+		string name = (const char*) sqlite3_column_text(stmt.ppStmt, 0);
+		party_handle party = parties.read(stmt.ppStmt, 1);
+		string info = (const char*) sqlite3_column_text(stmt.ppStmt, 3);
+		int rating = sqlite3_column_int(stmt.ppStmt, 4);
+
+		timer.add_row(name.size() + sizeof(party) + info.size() + sizeof(rating));
+		politicians.emplace_back(move(name), party, move(info), rating);
+	}
+	check_return<db_exception>(
+			ret, SQLITE_DONE, "Search", function_name, sqlite3_errmsg(connection));
+
+	return politicians;
+}
+
+std::int64_t database::count_politicians_by_name(const string& name, bool exists) const
+{
+	const string function_name = "count_politicians_by_name";
+	static query_counters counters(__func__);
+	query_timer timer(counters);
+
+	const string name_key = canonical_key(name);
+
+	sqlite_stmt_obj stmt(*this, exists ? sql_strings::exists_by_name : sql_strings::count_by_name,
+			function_name);
+
+	trace_span span("bind");
+	[[maybe_unused]] int ret = sqlite3_bind_text(stmt.ppStmt, 1, name_key.c_str(), -1,
+			SQLITE_STATIC);
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind name key", function_name, sqlite3_errmsg(connection));
+#endif
+
+	span.next("step");
+	return read_count(stmt, timer, connection);
+}
+
+std::int64_t database::count_politicians_by_party(const string& party, bool exists) const
+{
+	const string function_name = "count_politicians_by_party";
+	static query_counters counters(__func__);
+	query_timer timer(counters);
+
+	const string party_key = canonical_key(party);
+
+	sqlite_stmt_obj stmt(*this, sql_strings::count_by_party, function_name);
+
+	trace_span span("bind");
+	[[maybe_unused]] int ret = sqlite3_bind_text(stmt.ppStmt, 1, party_key.c_str(), -1,
+			SQLITE_STATIC);
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind party key", function_name, sqlite3_errmsg(connection));
+#endif
+
+	span.next("step");
+	std::int64_t members = read_count(stmt, timer, connection);
+	return exists ? members > 0 : members;
+}
+
+std::int64_t database::count_ratings_in_range(const politician_core& p,
+		const rating_range& range, bool exists) const
+{
+	const string function_name = "count_ratings_in_range";
+	static query_counters counters(__func__);
+	query_timer timer(counters);
+
+	const string name_key = canonical_key(p.name);
+
+	sqlite_stmt_obj stmt(*this, sql_strings::count_ratings_in_range, function_name);
+
+	trace_span span("bind");
+	[[maybe_unused]] int ret = sqlite3_bind_text(stmt.ppStmt, 1, name_key.c_str(), -1,
+			SQLITE_STATIC);
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind name key", function_name, sqlite3_errmsg(connection));
+#endif
+
+	ret = sqlite3_bind_text(stmt.ppStmt, 2, p.party.key().c_str(), -1, SQLITE_STATIC);
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind party key", function_name, sqlite3_errmsg(connection));
+#endif
+
+	ret = sqlite3_bind_int64(stmt.ppStmt, 3, range.from);
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind range start", function_name, sqlite3_errmsg(connection));
+#endif
+
+	ret = sqlite3_bind_int64(stmt.ppStmt, 4, range.to);
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind range end", function_name, sqlite3_errmsg(connection));
+#endif
+
+	// Existence is a count stopping at the first rating
+	ret = sqlite3_bind_int64(stmt.ppStmt, 5, exists ? 1
+			: range.limit == 0 ? -1 : static_cast<sqlite3_int64>(range.limit));
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind limit", function_name, sqlite3_errmsg(connection));
+#endif
+
+	span.next("step");
+	return read_count(stmt, timer, connection);
+}
+
+std::int64_t database::count_all_ratings_in_range(const rating_range& range,
+		bool exists) const
+{
+	const string function_name = "count_all_ratings_in_range";
+	static query_counters counters(__func__);
+	query_timer timer(counters);
+
+	sqlite_stmt_obj stmt(*this, sql_strings::count_all_ratings_in_range, function_name);
+
+	trace_span span("bind");
+	[[maybe_unused]] int ret = sqlite3_bind_int64(stmt.ppStmt, 1, range.from);
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind range start", function_name, sqlite3_errmsg(connection));
+#endif
+
+	ret = sqlite3_bind_int64(stmt.ppStmt, 2, range.to);
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind range end", function_name, sqlite3_errmsg(connection));
+#endif
+
+	ret = sqlite3_bind_int64(stmt.ppStmt, 3, exists ? 1
+			: range.limit == 0 ? -1 : static_cast<sqlite3_int64>(range.limit));
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind limit", function_name, sqlite3_errmsg(connection));
+#endif
+
+	span.next("step");
+	return read_count(stmt, timer, connection);
+}
+
+std::int64_t database::count_politicians(bool exists) const
+{
+	const string function_name = "count_politicians";
+	static query_counters counters(__func__);
+	query_timer timer(counters);
+
+	sqlite_stmt_obj stmt(*this, exists ? sql_strings::exists_politicians
+			: sql_strings::count_politicians, function_name);
+
+	trace_span span("step");
+	return read_count(stmt, timer, connection);
+}
+
+std::int64_t database::count_politicians_where(const filter_expression& filter,
+		bool exists) const
+{
+	const string function_name = "count_politicians_where";
+	static query_counters counters(__func__);
+	query_timer timer(counters);
+
+	string condition;
+	vector<std::pair<const string*, std::int64_t>> params;
+	compile_filter(filter, condition, params);
+
+	const string sql_query = exists
+		? string(sql_strings::exists_where) + condition + ");"
+		: string(sql_strings::count_where) + condition + ";";
+	sqlite_stmt_obj stmt(connection, sql_query.c_str(), function_name);
+
+	trace_span span("bind");
+	for(std::size_t i = 0; i < params.size(); ++i)
+	{
+		const int index = static_cast<int>(i) + 1;
+		[[maybe_unused]] int ret;
+		if(params[i].first != nullptr)
+			ret = sqlite3_bind_text(stmt.ppStmt, index, params[i].first->c_str(), -1,
+					SQLITE_STATIC);
+		else
+			ret = sqlite3_bind_int64(stmt.ppStmt, index, params[i].second);
+#ifdef DEBUG
+		check_return<db_exception>(
+				ret, SQLITE_OK, "Bind filter value", function_name, sqlite3_errmsg(connection));
+#endif
+	}
+
+	span.next("step");
+	return read_count(stmt, timer, connection);
+}
+
+std::int64_t database::count_politicians_batch(const vector<politician_core>& keys,
+		bool exists) const
+{
+	const string function_name = "count_politicians_batch";
+	static query_counters counters(__func__);
+	query_timer timer(counters);
+
+	const string json_keys = batch_keys_json(keys);
+
+	sqlite_stmt_obj stmt(*this, exists ? sql_strings::exists_politicians_batch
+			: sql_strings::count_politicians_batch, function_name);
+
+	trace_span span("bind");
+	[[maybe_unused]] int ret = sqlite3_bind_text(stmt.ppStmt, 1, json_keys.c_str(),
+			static_cast<int>(json_keys.size()), SQLITE_STATIC);
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind keys", function_name, sqlite3_errmsg(connection));
+#endif
+
+	span.next("step");
+	return read_count(stmt, timer, connection);
+}
+
+std::int64_t database::count_parties(bool exists) const
+{
+	const string function_name = "count_parties";
+	static query_counters counters(__func__);
+	query_timer timer(counters);
+
+	sqlite_stmt_obj stmt(*this, exists ? sql_strings::exists_parties
+			: sql_strings::count_parties, function_name);
+
+	trace_span span("step");
+	return read_count(stmt, timer, connection);
+}
+
+const vector<party_summary> database::get_party_leaderboard(const string& by,
+		const string& order) const
+{
+	const string function_name = "get_party_leaderboard";
+	static query_counters counters(__func__);
+	query_timer timer(counters);
+
+	if(order != "ASC" && order != "DESC")
+		throw std::domain_error(
+				"'order' parameter of function '" + function_name + "' not satisfed.\n"
+				"Expected: [DESC | ASC]. Got: " + order);
+
+	const char* column;
+	if(by == "total")
+		column = "total_rating";
+	else if(by == "avg")
+		column = "CAST(total_rating AS REAL) / member_count";
+	else if(by == "count")
+		column = "member_count";
+	else
+		throw std::domain_error(
+				"'by' parameter of function '" + function_name + "' not satisfed.\n"
+				"Expected: [total | avg | count]. Got: " + by);
+
+	char sql_query[300];
+	std::snprintf(sql_query, sizeof(sql_query), sql_strings::show_parties, column,
+			order.c_str());
+
+	sqlite_stmt_obj stmt(connection, sql_query, function_name);
+
+	vector<party_summary> parties;
+	party_cache handles;
+
+	trace_span span("step");
+	int ret;
+	while((ret = sqlite3_step(stmt.ppStmt)) == SQLITE_ROW)
+	{
+		party_handle party = handles.read(stmt.ppStmt, 0);
+		std::int64_t members = sqlite3_column_int64(stmt.ppStmt, 2);
+		std::int64_t total_rating = sqlite3_column_int64(stmt.ppStmt, 3);
+
+		timer.add_row(sizeof(party) + sizeof(members) + sizeof(total_rating));
+		parties.emplace_back(party, members, total_rating);
+	}
+	check_return<db_exception>(
+			ret, SQLITE_DONE, "Search", function_name, sqlite3_errmsg(connection));
+
+	return parties;
+}
+
+rating_histogram database::get_politician_histogram(const politician_core& p) const
+{
+	const string function_name = "get_politician_histogram";
+	static query_counters counters(__func__);
+	query_timer timer(counters);
+
+	const string name_key = canonical_key(p.name);
+
+	sqlite_stmt_obj stmt(*this, sql_strings::politician_histogram, function_name);
+
+	rating_histogram histogram;
+
+	trace_span span("bind");
+	int ret = sqlite3_bind_text(stmt.ppStmt, 1, name_key.c_str(), -1, SQLITE_STATIC);
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind name key", function_name, sqlite3_errmsg(connection));
+#endif
+
+	ret = sqlite3_bind_text(stmt.ppStmt, 2, p.party.key().c_str(), -1, SQLITE_STATIC);
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind party key", function_name, sqlite3_errmsg(connection));
+#endif
+
+	span.next("step");
+	while((ret = sqlite3_step(stmt.ppStmt)) == SQLITE_ROW)
+	{
+		short points = static_cast<short>(sqlite3_column_int(stmt.ppStmt, 0));
+		histogram[points] = sqlite3_column_int64(stmt.ppStmt, 1);
+		timer.add_row(sizeof(points) + sizeof(std::int64_t));
+	}
+	check_return<db_exception>(
+			ret, SQLITE_DONE, "Search", function_name, sqlite3_errmsg(connection));
+
+	return histogram;
+}
+
+rating_histogram database::get_party_histogram(const string& party) const
+{
+	const string function_name = "get_party_histogram";
+	static query_counters counters(__func__);
+	query_timer timer(counters);
+
+	const string party_key = canonical_key(party);
+
+	sqlite_stmt_obj stmt(*this, sql_strings::party_histogram, function_name);
+
+	rating_histogram histogram;
+
+	trace_span span("bind");
+	int ret = sqlite3_bind_text(stmt.ppStmt, 1, party_key.c_str(), -1, SQLITE_STATIC);
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Bind party key", function_name, sqlite3_errmsg(connection));
+#endif
+
+	span.next("step");
+	while((ret = sqlite3_step(stmt.ppStmt)) == SQLITE_ROW)
+	{
+		short points = static_cast<short>(sqlite3_column_int(stmt.ppStmt, 0));
+		histogram[points] = sqlite3_column_int64(stmt.ppStmt, 1);
+		timer.add_row(sizeof(points) + sizeof(std::int64_t));
+	}
+	check_return<db_exception>(
+			ret, SQLITE_DONE, "Search", function_name, sqlite3_errmsg(connection));
+
+	return histogram;
+}
+
+vector<politician_stats> database::get_politician_stats() const
+{
+	const string function_name = "get_politician_stats";
+	static query_counters counters(__func__);
+	query_timer timer(counters);
+
+	sqlite_stmt_obj stmt(*this, sql_strings::politician_stats, function_name);
+
+	vector<politician_stats> stats;
+	party_cache parties;
+
+	trace_span span("step");
+	int ret;
+	while((ret = sqlite3_step(stmt.ppStmt)) == SQLITE_ROW)
+	{
+		string name = (const char*) sqlite3_column_text(stmt.ppStmt, 0);
+		party_handle party = parties.read(stmt.ppStmt, 1);
+
+		timer.add_row(name.size() + sizeof(party) + 4 * sizeof(std::int64_t));
+		stats.push_back(politician_stats{move(name), party,
+				sqlite3_column_int64(stmt.ppStmt, 3), sqlite3_column_int64(stmt.ppStmt, 4),
+				sqlite3_column_int64(stmt.ppStmt, 5), sqlite3_column_int64(stmt.ppStmt, 6)});
+	}
+	check_return<db_exception>(
+			ret, SQLITE_DONE, "Search", function_name, sqlite3_errmsg(connection));
+
+	return stats;
+}
+
+void database::bulk_load(const std::function<void()>& load) const
+{
+	db_bulk_load transaction(*this);
+	load();
+	transaction.commit();
+}
+
+void database::read_snapshot(const std::function<void(std::int64_t)>& read) const
+{
+	db_snapshot snapshot(*this);
+	read(snapshot.data_version);
+	snapshot.transaction.commit();
+}
+
+busy_policy database::busy;
+
+const string database::DB_FILE("data.db");
+
+const string database::DB_PATH("/.local/share/politician/");
+
+sqlite_stmt_obj::sqlite_stmt_obj(sqlite3* connection, const char* query,
 		const string& function_name)
-	: function_name(function_name)
+	: function_name(function_name), cache(nullptr), query(query)
 {
+	trace_span span("prepare");
 	[[maybe_unused]] int ret = sqlite3_prepare_v2(connection, query, -1, &ppStmt, nullptr);
 #ifdef DEBUG
 	check_return<db_exception>(
@@ -358,16 +1620,107 @@ sqlite_stmt_obj::sqlite_stmt_obj(sqlite3* connection, const char* query,
 #endif
 }
 
+sqlite_stmt_obj::sqlite_stmt_obj(const database& db, const char* query,
+		const string& function_name)
+	: function_name(function_name), cache(&db), query(query)
+{
+	// The statement is taken out of the cache while in use, so that using the same
+	// query twice at once prepares a second statement instead of sharing it
+	auto it = db.statement_cache.find(query);
+	if(it != db.statement_cache.end())
+	{
+		ppStmt = it->second;
+		db.statement_cache.erase(it);
+		return;
+	}
+
+	trace_span span("prepare");
+	[[maybe_unused]] int ret = sqlite3_prepare_v3(db.connection, query, -1,
+			SQLITE_PREPARE_PERSISTENT, &ppStmt, nullptr);
+#ifdef DEBUG
+	check_return<db_exception>(
+			ret, SQLITE_OK, "Prepare", function_name, sqlite3_errmsg(db.connection));
+#endif
+}
+
 sqlite_stmt_obj::~sqlite_stmt_obj()
 {
+	if(cache != nullptr && ppStmt != nullptr)
+	{
+		sqlite3_reset(ppStmt);
+		sqlite3_clear_bindings(ppStmt);
+		if(cache->statement_cache.emplace(query, ppStmt).second)
+			return;
+	}
 	sqlite3_finalize(ppStmt);
 }
 
+db_transaction::db_transaction(const database& db, const char* begin)
+	: db(db), open(false), nested(sqlite3_get_autocommit(db.connection) == 0)
+{
+	db.execute(nested ? "SAVEPOINT nested;" : begin, "Begin transaction",
+			"db_transaction constructor");
+	open = true;
+}
+
+void db_transaction::commit()
+{
+	trace_span span("commit");
+	db.execute(nested ? "RELEASE nested;" : "COMMIT;", "Commit transaction",
+			"db_transaction::commit");
+	open = false;
+}
+
+db_transaction::~db_transaction()
+{
+	if(open)
+		sqlite3_exec(db.connection, nested ? "ROLLBACK TO nested; RELEASE nested;" : "ROLLBACK;",
+				nullptr, nullptr, nullptr);
+}
+
+db_bulk_load::db_bulk_load(const database& db)
+	: transaction(db, "BEGIN IMMEDIATE;")
+{
+	db.execute(sql_strings::begin_bulk_load, "Begin bulk load", "db_bulk_load constructor");
+}
+
+void db_bulk_load::commit()
+{
+	{
+		trace_span span("aggregates");
+		transaction.db.execute(sql_strings::finish_bulk_load, "Finish bulk load",
+				"db_bulk_load::commit");
+	}
+	transaction.commit();
+}
+
+db_snapshot::db_snapshot(const database& db)
+	: transaction(db), data_version(0)
+{
+	const string function_name = "db_snapshot constructor";
+
+	sqlite_stmt_obj stmt(db, sql_strings::get_data_version, function_name);
+	int ret = sqlite3_step(stmt.ppStmt);
+	check_return<db_exception>(ret, SQLITE_ROW, "Read data version", function_name,
+			sqlite3_errmsg(db.connection));
+	data_version = sqlite3_column_int64(stmt.ppStmt, 0);
+}
+
 namespace sql_strings
 {
-	const char* create_tables =
+	// Readers of a WAL database see the last commit before their read began, and
+	// neither block writers nor are blocked by them
+	const char* configure_connection =
 		"PRAGMA foreign_keys = ON;"
+		"PRAGMA journal_mode = WAL;";
 
+	const char* get_schema_version =
+		"PRAGMA user_version;";
+
+	const char* check_foreign_keys =
+		"PRAGMA foreign_key_check;";
+
+	const char* create_tables =
 		"CREATE TABLE IF NOT EXISTS politician"
 		"(name TEXT NOT NULL,"
 		" party TEXT NOT NULL,"
@@ -396,40 +1749,775 @@ namespace sql_strings
 		"   WHERE name = NEW.polit_name AND party = NEW.polit_party;"
 		"END;";
 
+	const char* add_lookup_keys =
+		"ALTER TABLE politician ADD COLUMN name_key TEXT;"
+		"ALTER TABLE politician ADD COLUMN party_key TEXT;"
+
+		"UPDATE politician"
+		" SET name_key = canonical_key(name), party_key = canonical_key(party);"
+
+		"CREATE UNIQUE INDEX idx_politician_key ON politician(name_key, party_key);"
+		"CREATE INDEX idx_politician_party_key ON politician(party_key);";
+
+	// Rows of the pre-version 2 politician table whose lookup keys collide
+	const char* lookup_key_collisions =
+		"SELECT name, party"
+		" FROM (SELECT name, party, canonical_key(name) AS name_key,"
+		"              canonical_key(party) AS party_key,"
+		"              COUNT(*) OVER (PARTITION BY canonical_key(name), canonical_key(party)) AS n"
+		"       FROM politician)"
+		" WHERE n > 1"
+		" ORDER BY party_key, name_key, name;";
+
+	const char* create_party_table =
+		"CREATE TABLE party"
+		"(id INTEGER PRIMARY KEY,"
+		" name TEXT NOT NULL,"
+		" name_key TEXT NOT NULL UNIQUE);"
+
+		"INSERT INTO party(name, name_key)"
+		" SELECT MIN(party), party_key FROM politician GROUP BY party_key;"
+
+		"CREATE TABLE politician_new"
+		"(name TEXT NOT NULL,"
+		" party_id INTEGER NOT NULL REFERENCES party(id),"
+		" information TEXT,"
+		" total_rating INTEGER DEFAULT 0,"
+		" name_key TEXT NOT NULL,"
+		" CONSTRAINT pk_politician PRIMARY KEY (name, party_id));"
+
+		"INSERT INTO politician_new(name, party_id, information, total_rating, name_key)"
+		" SELECT p.name, pt.id, p.information, p.total_rating, p.name_key"
+		" FROM politician p JOIN party pt ON pt.name_key = p.party_key;"
+
+		"CREATE TABLE ratings_new"
+		"(polit_name TEXT NOT NULL,"
+		" party_id INTEGER NOT NULL,"
+		" rating INTEGER NOT NULL CHECK(rating BETWEEN -5 AND 5),"
+		" description TEXT,"
+		" date_time TEXT NOT NULL DEFAULT (DATETIME('now', 'localtime')),"
+		" CONSTRAINT pk_ratings PRIMARY KEY (polit_name, party_id, date_time),"
+		" CONSTRAINT fk_ratings FOREIGN KEY (polit_name, party_id)"
+		"   REFERENCES politician(name, party_id)"
+		"   ON DELETE CASCADE"
+		"   ON UPDATE CASCADE);"
+
+		"INSERT INTO ratings_new(polit_name, party_id, rating, description, date_time)"
+		" SELECT r.polit_name, pt.id, r.rating, r.description, r.date_time"
+		" FROM ratings r"
+		" JOIN politician p ON p.name = r.polit_name AND p.party = r.polit_party"
+		" JOIN party pt ON pt.name_key = p.party_key;"
+
+		"DROP TRIGGER update_total_rating;"
+		"DROP TABLE ratings;"
+		"DROP TABLE politician;"
+		"ALTER TABLE politician_new RENAME TO politician;"
+		"ALTER TABLE ratings_new RENAME TO ratings;"
+
+		"CREATE UNIQUE INDEX idx_politician_key ON politician(name_key, party_id);"
+		"CREATE INDEX idx_politician_party ON politician(party_id);"
+
+		"CREATE TRIGGER update_total_rating"
+		" AFTER INSERT ON ratings"
+		" WHEN NEW.rating <> 0"
+		" BEGIN"
+		"   UPDATE politician"
+		"   SET total_rating = (total_rating + NEW.rating)"
+		"   WHERE name = NEW.polit_name AND party_id = NEW.party_id;"
+		"END;";
+
+	const char* add_politician_id =
+		"CREATE TABLE politician_new"
+		"(id INTEGER PRIMARY KEY,"
+		" name TEXT NOT NULL,"
+		" party_id INTEGER NOT NULL REFERENCES party(id),"
+		" information TEXT,"
+		" total_rating INTEGER DEFAULT 0,"
+		" name_key TEXT NOT NULL);"
+
+		"INSERT INTO politician_new(name, party_id, information, total_rating, name_key)"
+		" SELECT name, party_id, information, total_rating, name_key FROM politician;"
+
+		"CREATE TABLE ratings_new"
+		"(politician_id INTEGER NOT NULL,"
+		" rating INTEGER NOT NULL CHECK(rating BETWEEN -5 AND 5),"
+		" description TEXT,"
+		" date_time TEXT NOT NULL DEFAULT (DATETIME('now', 'localtime')),"
+		" CONSTRAINT pk_ratings PRIMARY KEY (politician_id, date_time),"
+		" CONSTRAINT fk_ratings FOREIGN KEY (politician_id)"
+		"   REFERENCES politician(id)"
+		"   ON DELETE CASCADE)"
+		" WITHOUT ROWID;"
+
+		"INSERT INTO ratings_new(politician_id, rating, description, date_time)"
+		" SELECT p.id, r.rating, r.description, r.date_time"
+		" FROM ratings r"
+		" JOIN politician_new p ON p.name = r.polit_name AND p.party_id = r.party_id;"
+
+		"DROP TRIGGER update_total_rating;"
+		"DROP TABLE ratings;"
+		"DROP TABLE politician;"
+		"ALTER TABLE politician_new RENAME TO politician;"
+		"ALTER TABLE ratings_new RENAME TO ratings;"
+
+		"CREATE UNIQUE INDEX idx_politician_key ON politician(name_key, party_id);"
+		"CREATE INDEX idx_politician_party ON politician(party_id);"
+
+		"CREATE TRIGGER update_total_rating"
+		" AFTER INSERT ON ratings"
+		" WHEN NEW.rating <> 0"
+		" BEGIN"
+		"   UPDATE politician"
+		"   SET total_rating = (total_rating + NEW.rating)"
+		"   WHERE id = NEW.politician_id;"
+		"END;";
+
+	const char* integer_timestamps =
+		"CREATE TABLE ratings_new"
+		"(politician_id INTEGER NOT NULL,"
+		" rating INTEGER NOT NULL CHECK(rating BETWEEN -5 AND 5),"
+		" description TEXT,"
+		// Microseconds since the Unix epoch, UTC
+		" date_time INTEGER NOT NULL"
+		"   DEFAULT (CAST((julianday('now') - 2440587.5) * 86400000000 AS INTEGER)),"
+		" CONSTRAINT pk_ratings PRIMARY KEY (politician_id, date_time),"
+		" CONSTRAINT fk_ratings FOREIGN KEY (politician_id)"
+		"   REFERENCES politician(id)"
+		"   ON DELETE CASCADE)"
+		" WITHOUT ROWID;"
+
+		// The old date/times are local time, which 'utc' converts from
+		"INSERT INTO ratings_new(politician_id, rating, description, date_time)"
+		" SELECT politician_id, rating, description,"
+		"   CAST(strftime('%s', date_time, 'utc') AS INTEGER) * 1000000"
+		" FROM ratings;"
+
+		"DROP TRIGGER update_total_rating;"
+		"DROP TABLE ratings;"
+		"ALTER TABLE ratings_new RENAME TO ratings;"
+
+		"CREATE TRIGGER update_total_rating"
+		" AFTER INSERT ON ratings"
+		" WHEN NEW.rating <> 0"
+		" BEGIN"
+		"   UPDATE politician"
+		"   SET total_rating = (total_rating + NEW.rating)"
+		"   WHERE id = NEW.politician_id;"
+		"END;";
+
+	const char* defer_aggregates =
+		// Only has a row inside bulk load transactions, which other connections
+		// never see
+		"CREATE TABLE bulk_load(active INTEGER);"
+
+		"DROP TRIGGER update_total_rating;"
+
+		"CREATE TRIGGER update_total_rating"
+		" AFTER INSERT ON ratings"
+		" WHEN NEW.rating <> 0 AND NOT EXISTS (SELECT 1 FROM bulk_load)"
+		" BEGIN"
+		"   UPDATE politician"
+		"   SET total_rating = (total_rating + NEW.rating)"
+		"   WHERE id = NEW.politician_id;"
+		"END;";
+
+	const char* maintain_totals =
+		"CREATE TRIGGER delete_total_rating"
+		" AFTER DELETE ON ratings"
+		" WHEN OLD.rating <> 0 AND NOT EXISTS (SELECT 1 FROM bulk_load)"
+		" BEGIN"
+		"   UPDATE politician"
+		"   SET total_rating = (total_rating - OLD.rating)"
+		"   WHERE id = OLD.politician_id;"
+		"END;"
+
+		"CREATE TRIGGER correct_total_rating"
+		" AFTER UPDATE OF rating, politician_id ON ratings"
+		" WHEN (NEW.rating <> OLD.rating OR NEW.politician_id <> OLD.politician_id)"
+		"   AND NOT EXISTS (SELECT 1 FROM bulk_load)"
+		" BEGIN"
+		"   UPDATE politician"
+		"   SET total_rating = (total_rating - OLD.rating)"
+		"   WHERE id = OLD.politician_id;"
+		"   UPDATE politician"
+		"   SET total_rating = (total_rating + NEW.rating)"
+		"   WHERE id = NEW.politician_id;"
+		"END;";
+
+	const char* party_aggregates =
+		"ALTER TABLE party ADD COLUMN member_count INTEGER NOT NULL DEFAULT 0;"
+		"ALTER TABLE party ADD COLUMN total_rating INTEGER NOT NULL DEFAULT 0;"
+
+		"UPDATE party"
+		" SET member_count = t.members, total_rating = t.total"
+		" FROM (SELECT party_id, COUNT(*) AS members, SUM(total_rating) AS total"
+		"       FROM politician GROUP BY party_id) t"
+		" WHERE t.party_id = party.id;"
+
+		"CREATE TRIGGER insert_party_member"
+		" AFTER INSERT ON politician"
+		" BEGIN"
+		"   UPDATE party"
+		"   SET member_count = member_count + 1, total_rating = total_rating + NEW.total_rating"
+		"   WHERE id = NEW.party_id;"
+		"END;"
+
+		// The ratings cascade after the politician is gone, so they don't change its total
+		"CREATE TRIGGER delete_party_member"
+		" AFTER DELETE ON politician"
+		" BEGIN"
+		"   UPDATE party"
+		"   SET member_count = member_count - 1, total_rating = total_rating - OLD.total_rating"
+		"   WHERE id = OLD.party_id;"
+		"END;"
+
+		// Also fired by the triggers maintaining politician.total_rating
+		"CREATE TRIGGER update_party_member"
+		" AFTER UPDATE OF party_id, total_rating ON politician"
+		" WHEN NEW.party_id <> OLD.party_id OR NEW.total_rating <> OLD.total_rating"
+		" BEGIN"
+		"   UPDATE party"
+		"   SET member_count = member_count - 1, total_rating = total_rating - OLD.total_rating"
+		"   WHERE id = OLD.party_id;"
+		"   UPDATE party"
+		"   SET member_count = member_count + 1, total_rating = total_rating + NEW.total_rating"
+		"   WHERE id = NEW.party_id;"
+		"END;";
+
+	const char* rating_histograms =
+		// Number of ratings of each politician and party with each of the points
+		"CREATE TABLE politician_histogram"
+		"(politician_id INTEGER NOT NULL REFERENCES politician(id) ON DELETE CASCADE,"
+		" rating INTEGER NOT NULL,"
+		" count INTEGER NOT NULL,"
+		" CONSTRAINT pk_politician_histogram PRIMARY KEY (politician_id, rating))"
+		" WITHOUT ROWID;"
+
+		"CREATE TABLE party_histogram"
+		"(party_id INTEGER NOT NULL REFERENCES party(id),"
+		" rating INTEGER NOT NULL,"
+		" count INTEGER NOT NULL,"
+		" CONSTRAINT pk_party_histogram PRIMARY KEY (party_id, rating))"
+		" WITHOUT ROWID;"
+
+		"INSERT INTO politician_histogram(politician_id, rating, count)"
+		" SELECT politician_id, rating, COUNT(*) FROM ratings GROUP BY politician_id, rating;"
+
+		"INSERT INTO party_histogram(party_id, rating, count)"
+		" SELECT p.party_id, h.rating, SUM(h.count)"
+		" FROM politician_histogram h JOIN politician p ON p.id = h.politician_id"
+		" GROUP BY p.party_id, h.rating;"
+
+		"CREATE TRIGGER insert_histogram"
+		" AFTER INSERT ON ratings"
+		" WHEN NOT EXISTS (SELECT 1 FROM bulk_load)"
+		" BEGIN"
+		"   INSERT INTO politician_histogram(politician_id, rating, count)"
+		"   VALUES(NEW.politician_id, NEW.rating, 1)"
+		"   ON CONFLICT DO UPDATE SET count = count + 1;"
+		"   INSERT INTO party_histogram(party_id, rating, count)"
+		"   SELECT party_id, NEW.rating, 1 FROM politician WHERE id = NEW.politician_id"
+		"   ON CONFLICT DO UPDATE SET count = count + 1;"
+		"END;"
+
+		"CREATE TRIGGER delete_histogram"
+		" AFTER DELETE ON ratings"
+		" WHEN NOT EXISTS (SELECT 1 FROM bulk_load)"
+		" BEGIN"
+		"   UPDATE politician_histogram"
+		"   SET count = count - 1"
+		"   WHERE politician_id = OLD.politician_id AND rating = OLD.rating;"
+		"   UPDATE party_histogram"
+		"   SET count = count - 1"
+		"   WHERE party_id = (SELECT party_id FROM politician WHERE id = OLD.politician_id)"
+		"     AND rating = OLD.rating;"
+		"END;"
+
+		"CREATE TRIGGER correct_histogram"
+		" AFTER UPDATE OF rating, politician_id ON ratings"
+		" WHEN (NEW.rating <> OLD.rating OR NEW.politician_id <> OLD.politician_id)"
+		"   AND NOT EXISTS (SELECT 1 FROM bulk_load)"
+		" BEGIN"
+		"   UPDATE politician_histogram"
+		"   SET count = count - 1"
+		"   WHERE politician_id = OLD.politician_id AND rating = OLD.rating;"
+		"   UPDATE party_histogram"
+		"   SET count = count - 1"
+		"   WHERE party_id = (SELECT party_id FROM politician WHERE id = OLD.politician_id)"
+		"     AND rating = OLD.rating;"
+		"   INSERT INTO politician_histogram(politician_id, rating, count)"
+		"   VALUES(NEW.politician_id, NEW.rating, 1)"
+		"   ON CONFLICT DO UPDATE SET count = count + 1;"
+		"   INSERT INTO party_histogram(party_id, rating, count)"
+		"   SELECT party_id, NEW.rating, 1 FROM politician WHERE id = NEW.politician_id"
+		"   ON CONFLICT DO UPDATE SET count = count + 1;"
+		"END;"
+
+		// Runs before the ratings cascade, which then find no histogram to update
+		"CREATE TRIGGER delete_politician_histogram"
+		" BEFORE DELETE ON politician"
+		" BEGIN"
+		"   UPDATE party_histogram"
+		"   SET count = party_histogram.count - h.count"
+		"   FROM politician_histogram h"
+		"   WHERE h.politician_id = OLD.id"
+		"     AND party_histogram.party_id = OLD.party_id AND party_histogram.rating = h.rating;"
+		"   DELETE FROM politician_histogram WHERE politician_id = OLD.id;"
+		"END;"
+
+		"CREATE TRIGGER move_politician_histogram"
+		" AFTER UPDATE OF party_id ON politician"
+		" WHEN NEW.party_id <> OLD.party_id"
+		" BEGIN"
+		"   UPDATE party_histogram"
+		"   SET count = party_histogram.count - h.count"
+		"   FROM politician_histogram h"
+		"   WHERE h.politician_id = NEW.id"
+		"     AND party_histogram.party_id = OLD.party_id AND party_histogram.rating = h.rating;"
+		"   INSERT INTO party_histogram(party_id, rating, count)"
+		"   SELECT NEW.party_id, rating, count FROM politician_histogram"
+		"   WHERE politician_id = NEW.id"
+		"   ON CONFLICT DO UPDATE SET count = party_histogram.count + excluded.count;"
+		"END;";
+
+	// Ranges of a single politician use the primary key, (politician_id, date_time)
+	const char* index_rating_dates =
+		"CREATE INDEX idx_ratings_date_time ON ratings(date_time);";
+
+	// Every change to politicians and ratings bumps the version once, bulk loads once
+	// for the whole load, when they finish
+	const char* data_version =
+		"CREATE TABLE data_version(version INTEGER NOT NULL);"
+		"INSERT INTO data_version(version) VALUES(0);"
+
+		"CREATE TRIGGER insert_politician_version"
+		" AFTER INSERT ON politician"
+		" BEGIN"
+		"   UPDATE data_version SET version = version + 1;"
+		"END;"
+
+		"CREATE TRIGGER update_politician_version"
+		" AFTER UPDATE OF name, party_id, information ON politician"
+		" BEGIN"
+		"   UPDATE data_version SET version = version + 1;"
+		"END;"
+
+		"CREATE TRIGGER delete_politician_version"
+		" AFTER DELETE ON politician"
+		" BEGIN"
+		"   UPDATE data_version SET version = version + 1;"
+		"END;"
+
+		"CREATE TRIGGER insert_rating_version"
+		" AFTER INSERT ON ratings"
+		" WHEN NOT EXISTS (SELECT 1 FROM bulk_load)"
+		" BEGIN"
+		"   UPDATE data_version SET version = version + 1;"
+		"END;"
+
+		"CREATE TRIGGER update_rating_version"
+		" AFTER UPDATE ON ratings"
+		" WHEN NOT EXISTS (SELECT 1 FROM bulk_load)"
+		" BEGIN"
+		"   UPDATE data_version SET version = version + 1;"
+		"END;"
+
+		"CREATE TRIGGER delete_rating_version"
+		" AFTER DELETE ON ratings"
+		" WHEN NOT EXISTS (SELECT 1 FROM bulk_load)"
+		" BEGIN"
+		"   UPDATE data_version SET version = version + 1;"
+		"END;";
+
+	// Bulk loads record the politicians whose ratings they changed, so that only
+	// their aggregates are recomputed when the load finishes
+	const char* track_bulk_loads =
+		"CREATE TABLE bulk_loaded(politician_id INTEGER PRIMARY KEY);"
+
+		"CREATE TRIGGER insert_bulk_loaded"
+		" AFTER INSERT ON ratings"
+		" WHEN EXISTS (SELECT 1 FROM bulk_load)"
+		" BEGIN"
+		"   INSERT OR IGNORE INTO bulk_loaded(politician_id) VALUES(NEW.politician_id);"
+		"END;"
+
+		"CREATE TRIGGER delete_bulk_loaded"
+		" AFTER DELETE ON ratings"
+		" WHEN EXISTS (SELECT 1 FROM bulk_load)"
+		" BEGIN"
+		"   INSERT OR IGNORE INTO bulk_loaded(politician_id) VALUES(OLD.politician_id);"
+		"END;"
+
+		"CREATE TRIGGER update_bulk_loaded"
+		" AFTER UPDATE OF rating, politician_id ON ratings"
+		" WHEN EXISTS (SELECT 1 FROM bulk_load)"
+		" BEGIN"
+		"   INSERT OR IGNORE INTO bulk_loaded(politician_id)"
+		"   VALUES(OLD.politician_id), (NEW.politician_id);"
+		"END;";
+
+	const char* const migrations[] = {
+		// Version 1: politician and ratings tables
+		create_tables,
+		// Version 2: canonical lookup keys of names and parties
+		add_lookup_keys,
+		// Version 3: parties move to their own table, referenced by integer ids
+		create_party_table,
+		// Version 4: politicians get an integer id, which is what ratings reference
+		add_politician_id,
+		// Version 5: ratings are timestamped with integer microseconds, UTC
+		integer_timestamps,
+		// Version 6: bulk loads defer the maintenance of aggregates
+		defer_aggregates,
+		// Version 7: deleted and corrected ratings also update the totals
+		maintain_totals,
+		// Version 8: parties keep their member count and the total of their members
+		party_aggregates,
+		// Version 9: politicians and parties keep a histogram of their rating points
+		rating_histograms,
+		// Version 10: ratings are indexed by date/time, for ranges over every politician
+		index_rating_dates,
+		// Version 11: the data has a version, which every change bumps
+		data_version,
+		// Version 12: bulk loads only recompute the aggregates of what they changed
+		track_bulk_loads,
+	};
+
+	const int schema_version = sizeof(migrations) / sizeof(*migrations);
+
+	const char* begin_bulk_load =
+		"INSERT INTO bulk_load(active) VALUES(1);";
+
+	// Rebuilds the histograms of the politicians in bulk_loaded from their ratings,
+	// then their totals from the histograms (which the party totals follow through
+	// update_party_member) and the histograms of their parties
+	const char* finish_bulk_load =
+		"DELETE FROM politician_histogram"
+		" WHERE politician_id IN (SELECT politician_id FROM bulk_loaded);"
+		"INSERT INTO politician_histogram(politician_id, rating, count)"
+		" SELECT r.politician_id, r.rating, COUNT(*)"
+		" FROM bulk_loaded b JOIN ratings r ON r.politician_id = b.politician_id"
+		" GROUP BY r.politician_id, r.rating;"
+
+		// Politicians left without ratings get a total of 0
+		"UPDATE politician"
+		" SET total_rating = t.total"
+		" FROM (SELECT b.politician_id, COALESCE(SUM(h.rating * h.count), 0) AS total"
+		"       FROM bulk_loaded b"
+		"       LEFT JOIN politician_histogram h ON h.politician_id = b.politician_id"
+		"       GROUP BY b.politician_id) t"
+		" WHERE t.politician_id = politician.id AND politician.total_rating <> t.total;"
+
+		"DELETE FROM party_histogram"
+		" WHERE party_id IN (SELECT p.party_id"
+		"                    FROM bulk_loaded b JOIN politician p ON p.id = b.politician_id);"
+		"INSERT INTO party_histogram(party_id, rating, count)"
+		" SELECT p.party_id, h.rating, SUM(h.count)"
+		" FROM politician p JOIN politician_histogram h ON h.politician_id = p.id"
+		" WHERE p.party_id IN (SELECT p.party_id"
+		"                      FROM bulk_loaded b JOIN politician p ON p.id = b.politician_id)"
+		" GROUP BY p.party_id, h.rating;"
+
+		"UPDATE data_version SET version = version + 1;"
+		"DELETE FROM bulk_loaded;"
+		"DELETE FROM bulk_load;";
+
+	const char* get_data_version =
+		"SELECT version FROM data_version;";
+
+	const char* politician_id_range =
+		"SELECT COUNT(*), MIN(id), MAX(id) FROM politician;";
+
+	// The drifts of the politicians with ids in [?1, ?2]: their total_rating, then
+	// their histogram counts, missing histogram rows counting as 0. The stored and
+	// actual counts are summed by a single GROUP BY rather than a FULL JOIN, which
+	// SQLite runs as a nested loop
+	const char* verify_politicians =
+		"WITH actual AS"
+		" (SELECT politician_id, rating, COUNT(*) AS count FROM ratings"
+		"  WHERE politician_id BETWEEN ?1 AND ?2"
+		"  GROUP BY politician_id, rating),"
+		" totals AS"
+		" (SELECT p.id, COALESCE(SUM(a.rating * a.count), 0) AS total"
+		"  FROM politician p LEFT JOIN actual a ON a.politician_id = p.id"
+		"  WHERE p.id BETWEEN ?1 AND ?2"
+		"  GROUP BY p.id),"
+		" histograms AS"
+		" (SELECT id, rating, SUM(stored) AS stored, SUM(actual) AS actual"
+		"  FROM (SELECT politician_id AS id, rating, count AS stored, 0 AS actual"
+		"        FROM politician_histogram WHERE politician_id BETWEEN ?1 AND ?2"
+		"        UNION ALL"
+		"        SELECT politician_id, rating, 0, count FROM actual)"
+		"  GROUP BY id, rating)"
+		" SELECT p.id, p.party_id, p.name, pt.name, 'total_rating', 0, p.total_rating, t.total,"
+		"        0 AS kind"
+		" FROM totals t JOIN politician p ON p.id = t.id JOIN party pt ON pt.id = p.party_id"
+		" WHERE p.total_rating IS NOT t.total"
+		" UNION ALL"
+		" SELECT p.id, p.party_id, p.name, pt.name, 'histogram', h.rating, h.stored, h.actual, 1"
+		" FROM histograms h JOIN politician p ON p.id = h.id JOIN party pt ON pt.id = p.party_id"
+		" WHERE h.stored <> h.actual"
+		// The share of the range in the actual member count and histogram of each party,
+		// with a politician_id of 0, for the caller to add up
+		" UNION ALL"
+		" SELECT 0, party_id, '', '', 'member_count', 0, 0, COUNT(*), 2"
+		" FROM politician WHERE id BETWEEN ?1 AND ?2"
+		" GROUP BY party_id"
+		" UNION ALL"
+		" SELECT 0, p.party_id, '', '', 'histogram', a.rating, 0, SUM(a.count), 3"
+		" FROM actual a JOIN politician p ON p.id = a.politician_id"
+		" GROUP BY p.party_id, a.rating"
+		" ORDER BY 1, 9, 6;";
+
+	const char* verify_party_aggregates =
+		"SELECT id, name, member_count, total_rating FROM party ORDER BY id;";
+
+	const char* verify_party_histograms =
+		"SELECT party_id, rating, count FROM party_histogram ORDER BY party_id, rating;";
+
+	const char* fix_total =
+		"UPDATE politician SET total_rating = ?1 WHERE id = ?2;";
+
+	const char* fix_politician_histogram =
+		"INSERT INTO politician_histogram(politician_id, rating, count) VALUES(?2, ?3, ?1)"
+		" ON CONFLICT DO UPDATE SET count = excluded.count;";
+
+	const char* fix_member_count =
+		"UPDATE party SET member_count = ?1 WHERE id = ?2;";
+
+	const char* fix_party_total =
+		"UPDATE party SET total_rating = ?1 WHERE id = ?2;";
+
+	const char* fix_party_histogram =
+		"INSERT INTO party_histogram(party_id, rating, count) VALUES(?2, ?3, ?1)"
+		" ON CONFLICT DO UPDATE SET count = excluded.count;";
+
+	// Followed by the compiled filter and the order
+	const char* search_where =
+		"SELECT p.name, pt.id, pt.name, p.information, p.total_rating"
+		" FROM politician p JOIN party pt ON pt.id = p.party_id"
+		" WHERE ";
+
+	const char* count_by_name =
+		"SELECT COUNT(*) FROM politician WHERE name_key = ?1;";
+
+	const char* exists_by_name =
+		"SELECT EXISTS (SELECT 1 FROM politician WHERE name_key = ?1);";
+
+	// The member count of the party is maintained, so there's nothing to count
+	const char* count_by_party =
+		"SELECT COALESCE((SELECT member_count FROM party WHERE name_key = ?1), 0);";
+
+	const char* count_ratings_in_range =
+		"SELECT COUNT(*) FROM"
+		" (SELECT 1"
+		"  FROM politician p JOIN party pt ON pt.id = p.party_id"
+		"  JOIN ratings r ON r.politician_id = p.id"
+		"  WHERE p.name_key = ?1 AND pt.name_key = ?2"
+		"    AND r.date_time >= ?3 AND r.date_time < ?4"
+		"  LIMIT ?5);";
+
+	const char* count_all_ratings_in_range =
+		"SELECT COUNT(*) FROM"
+		" (SELECT 1 FROM ratings"
+		"  WHERE date_time >= ?1 AND date_time < ?2"
+		"  LIMIT ?3);";
+
+	const char* count_politicians =
+		"SELECT COUNT(*) FROM politician;";
+
+	const char* exists_politicians =
+		"SELECT EXISTS (SELECT 1 FROM politician);";
+
+	// Followed by the compiled filter
+	const char* count_where =
+		"SELECT COUNT(*)"
+		" FROM politician p JOIN party pt ON pt.id = p.party_id"
+		" WHERE ";
+
+	// Followed by the compiled filter and a closing parenthesis
+	const char* exists_where =
+		"SELECT EXISTS (SELECT 1"
+		" FROM politician p JOIN party pt ON pt.id = p.party_id"
+		" WHERE ";
+
+	const char* count_politicians_batch =
+		"SELECT COUNT(*)"
+		" FROM json_each(?1) k"
+		" JOIN party pt ON pt.name_key = json_extract(k.value, '$[1]')"
+		" JOIN politician p"
+		"   ON p.name_key = json_extract(k.value, '$[0]') AND p.party_id = pt.id;";
+
+	const char* exists_politicians_batch =
+		"SELECT EXISTS (SELECT 1"
+		" FROM json_each(?1) k"
+		" JOIN party pt ON pt.name_key = json_extract(k.value, '$[1]')"
+		" JOIN politician p"
+		"   ON p.name_key = json_extract(k.value, '$[0]') AND p.party_id = pt.id);";
+
+	const char* count_parties =
+		"SELECT COUNT(*) FROM party WHERE member_count > 0;";
+
+	const char* exists_parties =
+		"SELECT EXISTS (SELECT 1 FROM party WHERE member_count > 0);";
+
+	const char* show_parties =
+		"SELECT id, name, member_count, total_rating"
+		" FROM party"
+		" WHERE member_count > 0"
+		" ORDER BY %s %s, name ASC";
+
+	const char* politician_histogram =
+		"SELECT h.rating, h.count"
+		" FROM politician p JOIN party pt ON pt.id = p.party_id"
+		" JOIN politician_histogram h ON h.politician_id = p.id"
+		" WHERE p.name_key = ?1 AND pt.name_key = ?2;";
+
+	const char* party_histogram =
+		"SELECT h.rating, h.count"
+		" FROM party pt JOIN party_histogram h ON h.party_id = pt.id"
+		" WHERE pt.name_key = ?1;";
+
+	const char* politician_stats =
+		"SELECT p.name, pt.id, pt.name, p.total_rating,"
+		"  (SELECT COALESCE(SUM(count), 0) FROM politician_histogram"
+		"   WHERE politician_id = p.id),"
+		"  (SELECT COALESCE(SUM(count), 0) FROM politician_histogram"
+		"   WHERE politician_id = p.id AND rating < 0),"
+		"  (SELECT COALESCE(MAX(date_time), 0) FROM ratings WHERE politician_id = p.id)"
+		" FROM politician p JOIN party pt ON pt.id = p.party_id"
+		" ORDER BY p.id;";
+
+	const char* search_party_id =
+		"SELECT id FROM party"
+		" WHERE name_key = ?1;";
+
+	const char* insert_to_party =
+		"INSERT INTO party(name, name_key)"
+		" VALUES(?1, ?2);";
+
 	const char* insert_to_politician =
-		"INSERT INTO politician(name, party, information) "
-		"VALUES(?1, ?2, ?3);";
+		"INSERT INTO politician(name, party_id, information, name_key)"
+		" VALUES(?1, ?2, ?3, ?4);";
 
 	const char* insert_to_ratings =
-		"INSERT INTO ratings(polit_name, polit_party, rating, description)"
-		" VALUES(?1, ?2, ?3, ?4);";
+		"INSERT INTO ratings(politician_id, rating, description, date_time)"
+		" SELECT p.id, ?3, ?4, ?5"
+		" FROM politician p JOIN party pt ON pt.id = p.party_id"
+		" WHERE p.name_key = ?1 AND pt.name_key = ?2;";
 
 	const char* search_by_name =
-		"SELECT * FROM politician"
-		" WHERE name = ?1;";
+		"SELECT p.name, pt.id, pt.name, p.information, p.total_rating"
+		" FROM politician p JOIN party pt ON pt.id = p.party_id"
+		" WHERE p.name_key = ?1;";
 
 	const char* search_by_party =
-		"SELECT * FROM politician"
-		" WHERE party = ?1;";
+		"SELECT p.name, pt.id, pt.name, p.information, p.total_rating"
+		" FROM party pt JOIN politician p ON p.party_id = pt.id"
+		" WHERE pt.name_key = ?1;";
 
 	const char* show_ratings =
-		"SELECT * FROM ratings"
-		" WHERE polit_name = ?1 AND polit_party = ?2;";
+		"SELECT p.name, pt.id, pt.name, r.rating, r.description, r.date_time"
+		" FROM politician p JOIN party pt ON pt.id = p.party_id"
+		" JOIN ratings r ON r.politician_id = p.id"
+		" WHERE p.name_key = ?1 AND pt.name_key = ?2"
+		" ORDER BY r.date_time ASC;";
+
+	// ?1 is a JSON array of [name_key, party_key] keys, k.key being their index
+	const char* search_politicians_batch =
+		"SELECT p.name, pt.id, pt.name, p.information, p.total_rating, k.key"
+		" FROM json_each(?1) k"
+		" JOIN party pt ON pt.name_key = json_extract(k.value, '$[1]')"
+		" JOIN politician p"
+		"   ON p.name_key = json_extract(k.value, '$[0]') AND p.party_id = pt.id;";
+
+	const char* show_ratings_batch =
+		"SELECT p.name, pt.id, pt.name, r.rating, r.description, r.date_time, k.key"
+		" FROM json_each(?1) k"
+		" JOIN party pt ON pt.name_key = json_extract(k.value, '$[1]')"
+		" JOIN politician p"
+		"   ON p.name_key = json_extract(k.value, '$[0]') AND p.party_id = pt.id"
+		" JOIN ratings r ON r.politician_id = p.id"
+		" ORDER BY k.key, r.date_time;";
+
+	const char* show_ratings_in_range_asc =
+		"SELECT p.name, pt.id, pt.name, r.rating, r.description, r.date_time"
+		" FROM politician p JOIN party pt ON pt.id = p.party_id"
+		" JOIN ratings r ON r.politician_id = p.id"
+		" WHERE p.name_key = ?1 AND pt.name_key = ?2"
+		"   AND r.date_time >= ?3 AND r.date_time < ?4"
+		" ORDER BY r.date_time ASC"
+		" LIMIT ?5;";
+
+	const char* show_ratings_in_range_desc =
+		"SELECT p.name, pt.id, pt.name, r.rating, r.description, r.date_time"
+		" FROM politician p JOIN party pt ON pt.id = p.party_id"
+		" JOIN ratings r ON r.politician_id = p.id"
+		" WHERE p.name_key = ?1 AND pt.name_key = ?2"
+		"   AND r.date_time >= ?3 AND r.date_time < ?4"
+		" ORDER BY r.date_time DESC"
+		" LIMIT ?5;";
+
+	// The index on date_time holds the primary key too, so it has the rows in order
+	const char* show_all_ratings_in_range_asc =
+		"SELECT p.name, pt.id, pt.name, r.rating, r.description, r.date_time"
+		" FROM ratings r JOIN politician p ON p.id = r.politician_id"
+		" JOIN party pt ON pt.id = p.party_id"
+		" WHERE r.date_time >= ?1 AND r.date_time < ?2"
+		" ORDER BY r.date_time ASC, r.politician_id ASC"
+		" LIMIT ?3;";
+
+	const char* show_all_ratings_in_range_desc =
+		"SELECT p.name, pt.id, pt.name, r.rating, r.description, r.date_time"
+		" FROM ratings r JOIN politician p ON p.id = r.politician_id"
+		" JOIN party pt ON pt.id = p.party_id"
+		" WHERE r.date_time >= ?1 AND r.date_time < ?2"
+		" ORDER BY r.date_time DESC, r.politician_id DESC"
+		" LIMIT ?3;";
 
 	const char* show_politicians =
-		"SELECT * FROM politician"
-		" ORDER BY total_rating %s, name ASC, party ASC";
+		"SELECT p.name, pt.id, pt.name, p.information, p.total_rating"
+		" FROM politician p JOIN party pt ON pt.id = p.party_id"
+		" ORDER BY p.total_rating %s, p.name ASC, pt.name ASC";
 
 	const char* show_politicians_compact =
-		"SELECT name, party FROM politician"
-		" ORDER BY total_rating %s, name ASC, party ASC";
+		"SELECT p.name, pt.id, pt.name"
+		" FROM politician p JOIN party pt ON pt.id = p.party_id"
+		" ORDER BY p.total_rating %s, p.name ASC, pt.name ASC";
+
+	// The latest ?1 ratings of a politician are the range of the primary key from the
+	// ?1-th newest one, or all of them (from ?2, the earliest date/time) if it has
+	// fewer
+	const char* show_politicians_with_ratings =
+		"SELECT p.id, p.name, pt.id, pt.name, p.information, p.total_rating,"
+		"  r.rating, r.description, r.date_time"
+		" FROM politician p JOIN party pt ON pt.id = p.party_id"
+		" LEFT JOIN ratings r"
+		"   ON ?1 > 0 AND r.politician_id = p.id"
+		"   AND r.date_time >= COALESCE("
+		"     (SELECT date_time FROM ratings WHERE politician_id = p.id"
+		"      ORDER BY date_time DESC LIMIT 1 OFFSET ?1 - 1), ?2)"
+		" ORDER BY p.total_rating %s, p.name ASC, pt.name ASC, p.id ASC, r.date_time DESC";
+
+	// Only the columns of the fields are in the SELECT list, so SQLite doesn't read
+	// the others, such as the overflow pages of a long information
+	const char* show_politicians_projected =
+		"SELECT %s"
+		" FROM politician p JOIN party pt ON pt.id = p.party_id"
+		" ORDER BY p.total_rating %s, p.name ASC, pt.name ASC";
+
+	const char* count_ratings =
+		"(SELECT COALESCE(SUM(count), 0) FROM politician_histogram"
+		" WHERE politician_id = p.id)";
 
 	const char* update_party =
 		"UPDATE politician"
-		" SET party = ?1"
-		" WHERE name = ?2 AND party = ?3;";
+		" SET party_id = ?1"
+		" WHERE name_key = ?2"
+		"   AND party_id = (SELECT id FROM party WHERE name_key = ?3);";
 
 	const char* delete_politician =
 		"DELETE FROM politician"
-		" WHERE name = ?1 AND party = ?2;";
+		" WHERE name_key = ?1"
+		"   AND party_id = (SELECT id FROM party WHERE name_key = ?2);";
 }
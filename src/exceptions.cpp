@@ -41,6 +41,7 @@ string politician_op_exception::generate_string(
 	switch(return_code)
 	{
 		case SQLITE_CONSTRAINT_PRIMARYKEY:
+		case SQLITE_CONSTRAINT_UNIQUE:
 			return "Politician already exists in the database.";
 
 		case SQLITE_CONSTRAINT_NOTNULL:
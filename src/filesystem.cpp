@@ -3,15 +3,21 @@
 #include <database.hpp>
 
 using std::filesystem::create_directories;
+using std::filesystem::path;
 using std::string;
 using std::getenv;
 
-string check_create_dirs()
+string get_db_dir()
 {
 	const char* home_dir = getenv("HOME");
 	if(home_dir == nullptr)
 		throw std::runtime_error("HOME environment variable not set");
-	string _path(string(home_dir) + database::DB_PATH);
-	create_directories(_path);
-	return _path;
+	return string(home_dir) + database::DB_PATH;
+}
+
+void create_parent_dirs(const string& file)
+{
+	path parent = path(file).parent_path();
+	if(parent.empty() == false)
+		create_directories(parent);
 }
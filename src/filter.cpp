@@ -0,0 +1,312 @@
+// Standard libraries
+#include <cctype>
+#include <stdexcept>
+
+// Local headers
+#include <filter.hpp>
+#include <normalize.hpp>
+#include <timestamp.hpp>
+
+using std::move;
+
+namespace
+{
+	// Bounds the recursion of the parser on nested parentheses and NOTs
+	const int max_depth = 64;
+
+	struct token
+	{
+		enum class kind
+		{
+			end,
+			word,
+			number,
+			date,
+			text,
+			op,
+			open,
+			close
+		};
+
+		kind type;
+		string value;
+		// Offset of the token in the expression, for error messages
+		std::size_t position;
+	};
+
+	bool is_word_char(char c)
+	{
+		return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+	}
+
+	bool is_digit(char c)
+	{
+		return std::isdigit(static_cast<unsigned char>(c));
+	}
+
+	string lowercase(string word)
+	{
+		for(char& c : word)
+			c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+		return word;
+	}
+
+	struct filter_parser
+	{
+		const string& expression;
+		std::size_t pos;
+		token current;
+		int depth;
+
+		explicit filter_parser(const string& expression)
+			: expression(expression), pos(0), current{token::kind::end, "", 0}, depth(0)
+		{
+			advance();
+		}
+
+		[[noreturn]] void fail(const string& expected) const
+		{
+			throw std::domain_error("Invalid filter at position "
+					+ std::to_string(current.position + 1) + ": expected " + expected
+					+ (current.type == token::kind::end ? ", got the end of the filter."
+						: ", got '" + current.value + "'."));
+		}
+
+		/** Reads the next token into 'current' */
+		void advance()
+		{
+			while(pos < expression.size()
+					&& std::isspace(static_cast<unsigned char>(expression[pos])))
+				++pos;
+			const std::size_t start = pos;
+			if(pos == expression.size())
+			{
+				current = token{token::kind::end, "", start};
+				return;
+			}
+
+			const char c = expression[pos];
+			if(c == '(' || c == ')')
+			{
+				++pos;
+				current = token{c == '(' ? token::kind::open : token::kind::close, string(1, c),
+					start};
+			}
+			else if(c == '\'' || c == '"')
+			{
+				// Quotes inside are doubled, as in SQL
+				string value;
+				for(++pos; ; ++pos)
+				{
+					if(pos == expression.size())
+					{
+						current = token{token::kind::end, "", start};
+						fail("a closing quote");
+					}
+					if(expression[pos] == c)
+					{
+						if(pos + 1 < expression.size() && expression[pos + 1] == c)
+							++pos;
+						else
+							break;
+					}
+					value += expression[pos];
+				}
+				++pos;
+				current = token{token::kind::text, move(value), start};
+			}
+			else if(is_digit(c) || (c == '-' && pos + 1 < expression.size()
+						&& is_digit(expression[pos + 1])))
+			{
+				++pos;
+				while(pos < expression.size()
+						&& (is_digit(expression[pos]) || expression[pos] == '-'))
+					++pos;
+				string value = expression.substr(start, pos - start);
+				// Dashes after the first character make it a date, YYYY-MM-DD
+				current = token{value.find('-', 1) == string::npos ? token::kind::number
+					: token::kind::date, move(value), start};
+			}
+			else if(is_word_char(c))
+			{
+				while(pos < expression.size() && is_word_char(expression[pos]))
+					++pos;
+				current = token{token::kind::word, expression.substr(start, pos - start), start};
+			}
+			else
+			{
+				static const char* const operators[] = {"<=", ">=", "!=", "<>", "==", "=", "<",
+					">"};
+				for(const char* op : operators)
+				{
+					if(expression.compare(pos, std::char_traits<char>::length(op), op) == 0)
+					{
+						pos += std::char_traits<char>::length(op);
+						current = token{token::kind::op, op, start};
+						return;
+					}
+				}
+				current = token{token::kind::op, string(1, c), start};
+				fail("an operator, a value or a parenthesis");
+			}
+		}
+
+		bool accept_keyword(const char* keyword)
+		{
+			if(current.type != token::kind::word || lowercase(current.value) != keyword)
+				return false;
+			advance();
+			return true;
+		}
+
+		/** expression := conjunction (OR conjunction)* */
+		filter_expression parse_expression()
+		{
+			if(++depth > max_depth)
+				fail("a shallower nesting");
+
+			filter_expression first = parse_conjunction();
+			if(current.type != token::kind::word || lowercase(current.value) != "or")
+			{
+				--depth;
+				return first;
+			}
+
+			filter_expression any{filter_expression::kind::any, {}, {}, {}, "", 0};
+			any.operands.push_back(move(first));
+			while(accept_keyword("or"))
+				any.operands.push_back(parse_conjunction());
+			--depth;
+			return any;
+		}
+
+		/** conjunction := negation (AND negation)* */
+		filter_expression parse_conjunction()
+		{
+			filter_expression first = parse_negation();
+			if(current.type != token::kind::word || lowercase(current.value) != "and")
+				return first;
+
+			filter_expression all{filter_expression::kind::all, {}, {}, {}, "", 0};
+			all.operands.push_back(move(first));
+			while(accept_keyword("and"))
+				all.operands.push_back(parse_negation());
+			return all;
+		}
+
+		/** negation := NOT negation | primary */
+		filter_expression parse_negation()
+		{
+			if(!accept_keyword("not"))
+				return parse_primary();
+
+			if(++depth > max_depth)
+				fail("a shallower nesting");
+			filter_expression negation{filter_expression::kind::negation, {}, {}, {}, "", 0};
+			negation.operands.push_back(parse_negation());
+			--depth;
+			return negation;
+		}
+
+		/** primary := '(' expression ')' | comparison | rated_since date | rated_before date */
+		filter_expression parse_primary()
+		{
+			if(current.type == token::kind::open)
+			{
+				advance();
+				filter_expression inner = parse_expression();
+				if(current.type != token::kind::close)
+					fail("')'");
+				advance();
+				return inner;
+			}
+			if(current.type != token::kind::word)
+				fail("a field, rated_since, rated_before, NOT or '('");
+
+			const string word = lowercase(current.value);
+			if(word == "rated_since" || word == "rated_before")
+			{
+				advance();
+				return filter_expression{word == "rated_since"
+					? filter_expression::kind::rated_since : filter_expression::kind::rated_before,
+					{}, {}, {}, "", parse_date()};
+			}
+
+			filter_field field;
+			if(word == "name")
+				field = filter_field::name;
+			else if(word == "party")
+				field = filter_field::party;
+			else if(word == "points")
+				field = filter_field::points;
+			else if(word == "ratings")
+				field = filter_field::ratings;
+			else
+				fail("a field (name, party, points or ratings)");
+			advance();
+
+			if(current.type != token::kind::op)
+				fail("a comparison operator");
+			filter_op op;
+			const string& symbol = current.value;
+			if(symbol == "=" || symbol == "==")
+				op = filter_op::equal;
+			else if(symbol == "!=" || symbol == "<>")
+				op = filter_op::not_equal;
+			else if(symbol == "<")
+				op = filter_op::less;
+			else if(symbol == "<=")
+				op = filter_op::less_equal;
+			else if(symbol == ">")
+				op = filter_op::greater;
+			else
+				op = filter_op::greater_equal;
+
+			filter_expression comparison{filter_expression::kind::comparison, {}, field, op, "", 0};
+			if(field == filter_field::name || field == filter_field::party)
+			{
+				if(op != filter_op::equal && op != filter_op::not_equal)
+					fail("= or != (names and parties are only compared for equality)");
+				advance();
+				if(current.type != token::kind::text)
+					fail("a quoted name or party");
+				comparison.text = canonical_key(current.value);
+			}
+			else
+			{
+				advance();
+				if(current.type != token::kind::number)
+					fail("an integer");
+				try
+				{
+					comparison.number = std::stoll(current.value);
+				}
+				catch(const std::out_of_range&)
+				{
+					fail("a smaller integer");
+				}
+			}
+			advance();
+			return comparison;
+		}
+
+		/** date := YYYY-MM-DD | 'YYYY-MM-DD[ HH:MM:SS[.ffffff]]', local time */
+		std::int64_t parse_date()
+		{
+			if(current.type != token::kind::date && current.type != token::kind::text)
+				fail("a date (YYYY-MM-DD)");
+			std::int64_t date_time = timestamp::parse(current.value);
+			advance();
+			return date_time;
+		}
+	};
+}
+
+filter_expression parse_filter(const string& expression)
+{
+	filter_parser parser(expression);
+	filter_expression filter = parser.parse_expression();
+	if(parser.current.type != token::kind::end)
+		parser.fail("AND, OR or the end of the filter");
+	return filter;
+}
@@ -0,0 +1,177 @@
+// Standard libraries
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+// Local headers
+#include <import.hpp>
+#include <exceptions.hpp>
+#include <timestamp.hpp>
+#include <trace.hpp>
+
+using std::string;
+using std::vector;
+using std::move;
+
+namespace
+{
+	/**
+	 * Reads the next CSV record of 'in' into 'fields', counting the lines read.
+	 * @return false at the end of the input
+	 */
+	bool read_record(std::istream& in, vector<string>& fields, std::size_t& line)
+	{
+		fields.clear();
+		string text;
+		if(!std::getline(in, text))
+			return false;
+
+		string field;
+		bool quoted = false;
+		while(true)
+		{
+			++line;
+			if(!text.empty() && text.back() == '\r')
+				text.pop_back();
+
+			for(std::size_t i = 0; i < text.size(); ++i)
+			{
+				char c = text[i];
+				if(quoted)
+				{
+					if(c != '"')
+						field += c;
+					else if(i + 1 < text.size() && text[i + 1] == '"')
+						field += text[++i];
+					else
+						quoted = false;
+				}
+				else if(c == '"')
+					quoted = true;
+				else if(c == ',')
+				{
+					fields.push_back(move(field));
+					field.clear();
+				}
+				else
+					field += c;
+			}
+
+			if(!quoted)
+				break;
+			// A newline inside quotes belongs to the field
+			if(!std::getline(in, text))
+				throw std::domain_error("Unterminated quoted field");
+			field += '\n';
+		}
+		fields.push_back(move(field));
+		return true;
+	}
+
+	short parse_points(const string& points)
+	{
+		std::size_t parsed = 0;
+		int value = 0;
+		try
+		{
+			value = std::stoi(points, &parsed);
+		}
+		catch(const std::logic_error&)
+		{}
+		if(parsed == 0 || parsed != points.size() || value < -5 || value > 5)
+			throw std::domain_error("Invalid rating points '" + points + "', expected [-5 to 5]");
+		return static_cast<short>(value);
+	}
+
+	/** Writes 'field' to 'out', quoted if it holds a comma, a quote or a newline */
+	void write_field(std::ostream& out, const string& field)
+	{
+		if(field.find_first_of(",\"\r\n") == string::npos)
+		{
+			out << field;
+			return;
+		}
+		out << '"';
+		for(char c : field)
+		{
+			if(c == '"')
+				out << '"';
+			out << c;
+		}
+		out << '"';
+	}
+}
+
+std::size_t import_ratings(const storage& db, std::istream& in)
+{
+	trace_span span("import");
+
+	std::size_t imported = 0;
+	db.bulk_load([&db, &in, &imported]
+	{
+		vector<string> fields;
+		std::size_t line = 0;
+		while(true)
+		{
+			const std::size_t record_line = line + 1;
+			try
+			{
+				if(!read_record(in, fields, line))
+					break;
+				if(record_line == 1 && fields.front() == "name")
+					continue;
+				if(fields.size() == 1 && fields.front().empty())
+					continue;
+				if(fields.size() != 5)
+					throw std::domain_error("Expected 5 fields (name,party,points,date/time,"
+							"description), got " + std::to_string(fields.size()));
+
+				std::int64_t date_time = fields[3].empty() ? 0 : timestamp::parse(fields[3]);
+				rating r(move(fields[0]), fields[1], move(fields[4]), parse_points(fields[2]),
+						date_time);
+				imported += static_cast<std::size_t>(db.insert_to_ratings(r));
+			}
+			catch(const db_exception& e)
+			{
+				throw db_exception("Line " + std::to_string(record_line) + ": " + e.what());
+			}
+			catch(const std::domain_error& e)
+			{
+				throw std::domain_error("Line " + std::to_string(record_line) + ": " + e.what());
+			}
+		}
+	});
+	return imported;
+}
+
+export_report export_ratings(const storage& db, std::ostream& out)
+{
+	trace_span span("export");
+
+	export_report report{0, 0};
+	db.read_snapshot([&db, &out, &report](std::int64_t data_version)
+	{
+		report.data_version = data_version;
+		out << "name,party,points,date/time,description\n";
+		const auto every = static_cast<std::size_t>(std::numeric_limits<std::int64_t>::max());
+		db.for_each_politician_with_ratings(every, "DESC",
+				[&out, &report](const politician& p, const vector<rating>& ratings)
+		{
+			// Oldest first, as they were rated
+			for(auto r = ratings.rbegin(); r != ratings.rend(); ++r)
+			{
+				write_field(out, p.name);
+				out << ',';
+				write_field(out, p.party.str());
+				out << ',' << r->points << ',' << timestamp::format(r->date_time, true) << ',';
+				write_field(out, r->description);
+				out << '\n';
+			}
+			report.ratings += ratings.size();
+		});
+		out.flush();
+		if(!out)
+			throw std::runtime_error("Could not write the exported ratings");
+	});
+	return report;
+}
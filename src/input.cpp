@@ -1,17 +1,26 @@
+// Standard libraries
+#include <fstream>
+#include <optional>
+#include <thread>
+
 // Local headers
 #include <input.hpp>
-#include <politician.hpp>
 #include <database.hpp>
+#include <politician.hpp>
+#include <storage.hpp>
+#include <import.hpp>
+#include <scoring.hpp>
+#include <normalize.hpp>
+#include <profile.hpp>
+#include <stats.hpp>
+#include <timestamp.hpp>
+#include <trace.hpp>
 
 // Command line parser
 #include <CLI11.hpp>
 
-// Allows Unicode strings' manipulation
-#include <boost/locale.hpp>
-
 using std::string;
 using std::move;
-using boost::locale::to_upper;
 
 bool confirm_operation(const string& operation)
 {
@@ -37,16 +46,62 @@ void replace_newline(string& to_replace)
 	}
 }
 
-int process_input(int argc, char** argv, const database& db)
+int process_input(int argc, char** argv)
 {
-	// Use default system locale
+	const auto input_start = trace::clock::now();
+	auto parse_start = input_start;
+
+	// The database is only opened once a subcommand needs it, so that printing the
+	// help or reporting a parsing error doesn't pay for it
+	string engine = storage_engines().front();
+	unsigned busy_timeout(static_cast<unsigned>(database::busy.timeout.count()));
+	unsigned busy_backoff(static_cast<unsigned>(std::chrono::duration_cast<
+			std::chrono::milliseconds>(database::busy.max_backoff).count()));
+	std::unique_ptr<storage> db_instance;
+	auto db = [&db_instance, &engine, &busy_timeout, &busy_backoff]() -> const storage&
 	{
-		boost::locale::generator gen;
-		std::locale::global(gen(""));
-	}
+		if(!db_instance)
+		{
+			database::busy.timeout = std::chrono::milliseconds(busy_timeout);
+			database::busy.max_backoff = std::chrono::milliseconds(busy_backoff);
+			db_instance = open_storage(engine);
+		}
+		return *db_instance;
+	};
+
+	std::optional<startup_phase> setup_phase(std::in_place, "cli setup");
 
 	CLI::App app("Rate and search politicians");
 	app.require_subcommand(1);
+	// Allows the global options to be given after the subcommands
+	app.fallthrough();
+
+	bool profile_startup(false);
+	app.add_flag("--profile-startup", profile_startup,
+			"Report a breakdown of the time spent in each startup phase");
+	// Option callbacks run before the subcommands', so every query gets recorded
+	app.add_flag_callback("--stats", query_stats::enable,
+			"Report the call count, latency and rows of every database operation");
+	string trace_file;
+	app.add_option("--trace", trace_file,
+			"Write a Chrome trace (chrome://tracing, Perfetto) of the execution to a file")
+		->each([&input_start, &parse_start](const string&)
+		{
+			// Parsing is already over once option callbacks run, so its spans are
+			// recorded retroactively
+			trace::enable();
+			trace::complete("cli setup", input_start, parse_start);
+			trace::complete("cli parse", parse_start, trace::clock::now());
+		});
+
+	app.add_option("--engine", engine, "Storage engine (memory doesn't persist anything)", true)
+		->check(CLI::IsMember(storage_engines()));
+	app.add_option("--busy-timeout", busy_timeout,
+			"Milliseconds to keep retrying when another process holds the database lock, "
+			"0 to fail at once", true);
+	app.add_option("--busy-backoff", busy_backoff,
+			"Maximum milliseconds between retries, which back off exponentially up to it", true)
+		->check(CLI::Range(1u, 60000u));
 
 	auto reg = app.add_subcommand("register",
 			"Register a new politician in the database");
@@ -63,7 +118,7 @@ int process_input(int argc, char** argv, const database& db)
 		p.print_data();
 		if(confirm_operation("insertion"))
 		{
-			if(db.insert_to_politician(p))
+			if(db().insert_to_politician(p))
 				std::cout << "Successfully inserted.\n";
 			else
 				std::cerr << "Insertion failed.\n";
@@ -78,16 +133,21 @@ int process_input(int argc, char** argv, const database& db)
 	rate->add_option("-r,--rate", points,
 			"Rating points to add/subtract [-5 to 5]")->required();
 	rate->add_option("-d,--description", desc, "Description or reason for the rate");
-	rate->callback([&name, &party, &desc, &points, &db]
+	string date_time;
+	rate->add_option("-t,--date-time", date_time,
+			"Local date/time of the rate (YYYY-MM-DD[ HH:MM:SS[.ffffff][Z|+HH:MM|-HH:MM]]),"
+			" defaults to now");
+	rate->callback([&name, &party, &desc, &points, &date_time, &db]
 	{
 		replace_newline(desc);
 		// Converts name and party to uppercase to make these columns case insensitive
 		// on every SQL query/operation
-		rating r(to_upper(name), to_upper(party), move(desc), points);
+		rating r(to_upper(name), to_upper(party), move(desc), points,
+				date_time.empty() ? 0 : timestamp::parse(date_time));
 		r.print_data();
 		if(confirm_operation("rating"))
 		{
-			if(db.insert_to_ratings(r))
+			if(db().insert_to_ratings(r))
 				std::cout << "Successfully inserted.\n";
 			else
 				std::cerr << "Insertion failed.\n";
@@ -107,7 +167,7 @@ int process_input(int argc, char** argv, const database& db)
 		p.print_data();
 		if(confirm_operation("update"))
 		{
-			if(db.update_party(p))
+			if(db().update_party(p))
 				std::cout << "Successfully updated.\n";
 			else
 				std::cerr << "Update failed. The politician was not found.\n";
@@ -125,21 +185,113 @@ int process_input(int argc, char** argv, const database& db)
 		p.print_data();
 		if(confirm_operation("deletion"))
 		{
-			if(db.delete_politician(p))
+			if(db().delete_politician(p))
 				std::cout << "Successfully deleted.\n";
 			else
 				std::cerr << "Deletion failed. The politician was not found.\n";
 		}
 	});
 
+	auto import = app.add_subcommand("import",
+			"Import ratings of existing politicians from a CSV file");
+	string import_file;
+	import->add_option("file", import_file,
+			"CSV file with the columns name,party,points,date/time,description ('-' reads "
+			"the standard input)")->required();
+	import->callback([&import_file, &db]
+	{
+		std::size_t imported;
+		if(import_file == "-")
+			imported = import_ratings(db(), std::cin);
+		else
+		{
+			std::ifstream in(import_file);
+			if(!in)
+				throw std::runtime_error("Could not open '" + import_file + "'");
+			imported = import_ratings(db(), in);
+		}
+		std::cout << imported << " ratings imported.\n";
+	});
+
+	auto export_cmd = app.add_subcommand("export",
+			"Export every rating to a CSV file that import reads, from a consistent snapshot");
+	string export_file;
+	export_cmd->add_option("file", export_file,
+			"CSV file to write ('-' writes to the standard output)")->required();
+	export_cmd->callback([&export_file, &db]
+	{
+		export_report report;
+		if(export_file == "-")
+			report = export_ratings(db(), std::cout);
+		else
+		{
+			std::ofstream out(export_file);
+			if(!out)
+				throw std::runtime_error("Could not open '" + export_file + "'");
+			report = export_ratings(db(), out);
+		}
+		// The CSV may be on stdout, the report isn't part of it
+		std::cerr << "Exported " << report.ratings << " ratings (data version "
+		          << report.data_version << ").\n";
+	});
+
+	auto maintenance = app.add_subcommand("maintenance", "Database maintenance");
+	maintenance->require_subcommand(1);
+
+	auto verify = maintenance->add_subcommand("verify-totals",
+			"Recompute the totals, member counts and histograms of every politician and party "
+			"and report the wrong ones");
+	bool fix(false);
+	unsigned threads(std::max(1u, std::thread::hardware_concurrency()));
+	verify->add_flag("--fix", fix, "Store the recomputed values of the wrong ones");
+	verify->add_option("-j,--threads", threads, "Number of worker threads", true)
+		->check(CLI::Range(1u, 256u));
+	verify->callback([&fix, &threads, &db]
+	{
+		verify_report report = db().verify_totals(threads, fix);
+		for(const aggregate_drift& drift : report.drifts)
+		{
+			if(drift.politician_id != 0)
+				std::cout << drift.name << " (" << drift.party << "): ";
+			else
+				std::cout << "Party " << drift.party << ": ";
+			std::cout << drift.aggregate;
+			if(drift.aggregate == "histogram")
+				std::cout << "[" << (drift.points > 0 ? "+" : "") << drift.points << "]";
+			std::cout << " is " << drift.stored << ", should be " << drift.actual << "\n";
+		}
+		std::cout << report.politicians << " politicians and " << report.parties
+		          << " parties checked, " << report.drifts.size()
+		          << (fix ? " aggregates fixed.\n" : " aggregates wrong.\n");
+	});
+
 	auto search = app.add_subcommand("search", "Search options");
 	search->require_subcommand(1);
 
+	// Only one search subcommand runs, so they all share these flags
+	bool count_only(false), exists_only(false);
+	auto add_count_flags = [&count_only, &exists_only](CLI::App* subcommand)
+	{
+		auto count = subcommand->add_flag("--count", count_only,
+				"Only print the number of results, without retrieving them");
+		subcommand->add_flag("--exists", exists_only,
+				"Only print 1 if there is any result and 0 otherwise, stopping at the first one")
+			->excludes(count);
+	};
+
 	auto search_name = search->add_subcommand("name", "Search a politician by name");
 	search_name->add_option("name", name, "Name of the politician")->required();
-	search_name->callback([&name, &db]
+	add_count_flags(search_name);
+	search_name->callback([&name, &count_only, &exists_only, &db]
 	{
-		vector<politician> politicians = db.get_politician_by_name(to_upper(name));
+		if(count_only || exists_only)
+		{
+			std::cout << db().count_politicians_by_name(name, exists_only) << "\n";
+			return;
+		}
+
+		vector<politician> politicians = db().get_politician_by_name(name);
+		trace_span span("print");
 		for_each(politicians.begin(), politicians.end(), [](const politician& p)
 		{
 			p.print_data();
@@ -151,9 +303,17 @@ int process_input(int argc, char** argv, const database& db)
 	auto search_party = search->add_subcommand("party",
 			"Show all politicians belonging to a party");
 	search_party->add_option("party", party, "Party to be searched")->required();
-	search_party->callback([&party, &db]
+	add_count_flags(search_party);
+	search_party->callback([&party, &count_only, &exists_only, &db]
 	{
-		vector<politician> politicians = db.get_politicians_by_party(to_upper(party));
+		if(count_only || exists_only)
+		{
+			std::cout << db().count_politicians_by_party(party, exists_only) << "\n";
+			return;
+		}
+
+		vector<politician> politicians = db().get_politicians_by_party(party);
+		trace_span span("print");
 		for_each(politicians.begin(), politicians.end(), [](const politician& p)
 		{
 			p.print_data();
@@ -163,13 +323,44 @@ int process_input(int argc, char** argv, const database& db)
 	});
 
 	auto search_ratings = search->add_subcommand("ratings",
-			"Show all ratings belonging to a politician");
-	search_ratings->add_option("-n,--name", name, "Name of the politician")->required();
+			"Show the ratings of a politician, or of every politician, by date/time");
+	string ratings_name, from, to, ratings_order("asc");
+	std::size_t limit(0);
+	search_ratings->add_option("-n,--name", ratings_name,
+			"Name of the politician, every politician's ratings are shown without it");
 	search_ratings->add_option("-p,--party", party, "Party of the politician");
-	search_ratings->callback([&name, &party, &db]
+	search_ratings->add_option("--from", from,
+			"Only the ratings at or after this local date/time (YYYY-MM-DD[ HH:MM:SS])");
+	search_ratings->add_option("--to", to,
+			"Only the ratings before this local date/time (YYYY-MM-DD[ HH:MM:SS])");
+	search_ratings->add_option("--order", ratings_order,
+			"Oldest (asc) or newest (desc) first", true)
+		->check(CLI::IsMember({"asc", "desc"}));
+	search_ratings->add_option("--limit", limit, "Show at most this many ratings");
+	add_count_flags(search_ratings);
+	search_ratings->callback([&ratings_name, &party, &from, &to, &ratings_order, &limit,
+			&count_only, &exists_only, &db]
 	{
-		vector<rating> ratings = db.get_politician_ratings(
-				politician_core(to_upper(name), to_upper(party)));
+		rating_range range;
+		if(!from.empty())
+			range.from = timestamp::parse(from);
+		if(!to.empty())
+			range.to = timestamp::parse(to);
+		range.descending = ratings_order == "desc";
+		range.limit = limit;
+
+		if(count_only || exists_only)
+		{
+			std::cout << (ratings_name.empty()
+				? db().count_all_ratings_in_range(range, exists_only)
+				: db().count_ratings_in_range(politician_core(ratings_name, party), range,
+					exists_only)) << "\n";
+			return;
+		}
+
+		vector<rating> ratings = ratings_name.empty() ? db().get_all_ratings_in_range(range)
+			: db().get_ratings_in_range(politician_core(ratings_name, party), range);
+		trace_span span("print");
 		for_each(ratings.begin(), ratings.end(), [](const rating& r)
 		{
 			r.print_data();
@@ -178,18 +369,143 @@ int process_input(int argc, char** argv, const database& db)
 		std::cout << ratings.size() << " results returned.\n";
 	});
 
+	auto search_compare = search->add_subcommand("compare",
+			"Compare politicians side by side, with their ratings, fetched all at once");
+	vector<string> compare_names, compare_parties;
+	search_compare->add_option("-n,--name", compare_names,
+			"Name of a politician, given once per politician")->required();
+	search_compare->add_option("-p,--party", compare_parties,
+			"Party of each politician, in the order of the names, or a single party for all");
+	add_count_flags(search_compare);
+	search_compare->callback([&compare_names, &compare_parties, &count_only, &exists_only, &db]
+	{
+		if(compare_parties.size() > 1 && compare_parties.size() != compare_names.size())
+			throw std::domain_error("Expected a party for each of the "
+					+ std::to_string(compare_names.size()) + " politicians, or a single one. Got "
+					+ std::to_string(compare_parties.size()) + " parties.");
+
+		vector<politician_core> keys;
+		keys.reserve(compare_names.size());
+		for(std::size_t i = 0; i < compare_names.size(); ++i)
+		{
+			keys.emplace_back(compare_names[i], compare_parties.empty() ? "None"
+					: compare_parties[compare_parties.size() > 1 ? i : 0]);
+		}
+
+		if(count_only || exists_only)
+		{
+			std::cout << db().count_politicians_batch(keys, exists_only) << "\n";
+			return;
+		}
+
+		// Both batches come from the same snapshot, so a rating committed in between
+		// can't show up for a politician read before it
+		db().read_snapshot([&keys, &db](std::int64_t)
+		{
+			const vector<std::optional<politician>> politicians = db().get_politicians_batch(keys);
+			const vector<vector<rating>> ratings = db().get_ratings_batch(keys);
+
+			trace_span span("print");
+			std::size_t found = 0;
+			for(std::size_t i = 0; i < keys.size(); ++i)
+			{
+				if(!politicians[i])
+				{
+					keys[i].print_data();
+					std::cout << "Not found.\n\n";
+					continue;
+				}
+
+				++found;
+				politicians[i]->print_data();
+				std::int64_t total = 0;
+				for(const rating& r : ratings[i])
+					total += r.points;
+				char mean[32];
+				std::snprintf(mean, sizeof(mean), "%.2f", ratings[i].empty() ? 0.0
+						: static_cast<double>(total) / static_cast<double>(ratings[i].size()));
+				std::cout << "Ratings: " << ratings[i].size() << ", mean " << mean << "\n";
+				for(const rating& r : ratings[i])
+					r.print_line();
+				std::cout << "\n";
+			}
+			std::cout << found << " results returned.\n";
+		});
+	});
+
 	auto search_all = search->add_subcommand("all",
 			"Show all politicians ordered by highest rating");
 	bool _reverse(false), full(false);
 	search_all->add_flag("-r,--reverse", _reverse, "Order by lowest to highest rating");
 	search_all->add_flag("-f,--full", full,
 			"Includes the description and rating points of each politician");
-	search_all->callback([&_reverse, &full, &db]
+	vector<string> field_names;
+	auto fields_option = search_all->add_option("--fields", field_names,
+			"Only shows these fields of each politician, e.g. name,points "
+			"(name, party, information, points or ratings)")
+		->delimiter(',')
+		->check(CLI::IsMember(politician_fields()))
+		->excludes("-f");
+	std::size_t with_ratings(0);
+	search_all->add_option("--with-ratings", with_ratings,
+			"Also shows the latest N ratings of each politician, newest first")
+		->excludes(fields_option);
+	add_count_flags(search_all);
+	search_all->callback([&_reverse, &full, &field_names, &with_ratings, &count_only,
+			&exists_only, &db]
 	{
+		if(count_only || exists_only)
+		{
+			std::cout << db().count_politicians(exists_only) << "\n";
+			return;
+		}
+
 		string search_order = _reverse ? "ASC" : "DESC";
-		if(full)
+		if(with_ratings > 0)
 		{
-			vector<politician> politicians = db.get_all_politicians(search_order);
+			// Printed one politician at a time, as the rows of the query are grouped
+			std::size_t politicians = 0;
+			trace_span span("query and print");
+			db().for_each_politician_with_ratings(with_ratings, search_order,
+					[&politicians](const politician& p, const vector<rating>& ratings)
+			{
+				p.print_data();
+				std::cout << "Latest ratings: " << ratings.size() << "\n";
+				for(const rating& r : ratings)
+					r.print_line();
+				std::cout << "\n";
+				++politicians;
+			});
+			std::cout << politicians << " results returned.\n";
+		}
+		else if(!field_names.empty())
+		{
+			// A field repeated is only shown once, where it first appears
+			vector<politician_field> fields;
+			for(const string& field_name : field_names)
+			{
+				auto it = std::find(politician_fields().begin(), politician_fields().end(),
+						field_name);
+				const auto field = static_cast<politician_field>(it - politician_fields().begin());
+				if(std::find(fields.begin(), fields.end(), field) == fields.end())
+					fields.push_back(field);
+			}
+
+			vector<projected_politician> politicians = db().get_politicians_projected(fields,
+					search_order);
+			trace_span span("print");
+			for_each(politicians.begin(), politicians.end(),
+					[&fields](const projected_politician& p)
+			{
+				p.print_data(fields);
+				std::cout << "\n";
+			});
+			std::cout << politicians.size() << " results returned.\n";
+		}
+		else if(full)
+		{
+			vector<politician> politicians = db().get_all_politicians(search_order);
+			trace_span span("print");
 			for_each(politicians.begin(), politicians.end(), [](const politician& p)
 			{
 				p.print_data();
@@ -199,7 +515,8 @@ int process_input(int argc, char** argv, const database& db)
 		}
 		else
 		{
-			vector<politician_core> politicians = db.get_politicians_compact(search_order);
+			vector<politician_core> politicians = db().get_politicians_compact(search_order);
+			trace_span span("print");
 			for_each(politicians.begin(), politicians.end(), [](const politician_core& p)
 			{
 				p.print_data();
@@ -209,7 +526,149 @@ int process_input(int argc, char** argv, const database& db)
 		}
 	});
 
-	CLI11_PARSE(app, argc, argv);
+	auto search_where = search->add_subcommand("where",
+			"Show the politicians matching a filter, e.g. "
+			"\"party = 'X' AND points > 10 AND rated_since 2022-01-01\"");
+	string filter;
+	search_where->add_option("filter", filter,
+			"Comparisons of name, party (= and != only), points or ratings (number of "
+			"ratings), and rated_since/rated_before <YYYY-MM-DD>, combined with AND, OR, NOT "
+			"and parentheses")->required();
+	add_count_flags(search_where);
+	search_where->callback([&filter, &count_only, &exists_only, &db]
+	{
+		if(count_only || exists_only)
+		{
+			std::cout << db().count_politicians_where(parse_filter(filter), exists_only) << "\n";
+			return;
+		}
+
+		vector<politician> politicians = db().get_politicians_where(parse_filter(filter));
+		trace_span span("print");
+		for_each(politicians.begin(), politicians.end(), [](const politician& p)
+		{
+			p.print_data();
+			std::cout << "\n";
+		});
+		std::cout << politicians.size() << " results returned.\n";
+	});
+
+	auto search_parties = search->add_subcommand("parties",
+			"Show all parties with members, ordered by the total rating of their members");
+	string by("total");
+	bool reverse_parties(false);
+	search_parties->add_option("--by", by,
+			"Order by total rating, average rating per member (avg) or members (count)", true)
+		->check(CLI::IsMember(leaderboard_orders()));
+	search_parties->add_flag("-r,--reverse", reverse_parties, "Order from lowest to highest");
+	add_count_flags(search_parties);
+	search_parties->callback([&by, &reverse_parties, &count_only, &exists_only, &db]
+	{
+		if(count_only || exists_only)
+		{
+			std::cout << db().count_parties(exists_only) << "\n";
+			return;
+		}
+
+		vector<party_summary> parties = db().get_party_leaderboard(by,
+				reverse_parties ? "ASC" : "DESC");
+		trace_span span("print");
+		for_each(parties.begin(), parties.end(), [](const party_summary& p)
+		{
+			p.print_data();
+			std::cout << "\n";
+		});
+		std::cout << parties.size() << " results returned.\n";
+	});
+
+	auto search_histogram = search->add_subcommand("histogram",
+			"Show how many ratings of each points a politician, or a party, has");
+	string histogram_name;
+	bool json(false);
+	search_histogram->add_option("-n,--name", histogram_name,
+			"Name of the politician, the whole party is shown without it");
+	search_histogram->add_option("-p,--party", party, "Party of the politician, or the party");
+	search_histogram->add_flag("--json", json, "Print the counts as JSON");
+	add_count_flags(search_histogram);
+	search_histogram->callback([&histogram_name, &party, &json, &count_only, &exists_only, &db]
+	{
+		rating_histogram histogram = histogram_name.empty() ? db().get_party_histogram(party)
+			: db().get_politician_histogram(politician_core(histogram_name, party));
+		// The results of a histogram are the ratings it counts
+		if(count_only || exists_only)
+		{
+			std::cout << (exists_only ? histogram.ratings() > 0 : histogram.ratings()) << "\n";
+			return;
+		}
+		trace_span span("print");
+		if(json)
+			histogram.print_json(std::cout);
+		else
+			histogram.print_data();
+	});
+
+	auto search_rank = search->add_subcommand("rank",
+			"Rank the politicians by a weighted sum of their total, mean, recency and "
+			"negative ratings");
+	score_weights weights;
+	std::size_t top(10);
+	search_rank->add_option("--total", weights.total, "Weight of the total rating", true);
+	search_rank->add_option("--mean", weights.mean, "Weight of the mean rating", true);
+	search_rank->add_option("--recency", weights.recency,
+			"Weight of the recency, 1 / (1 + days since the latest rating)", true);
+	search_rank->add_option("--negatives", weights.negatives,
+			"Weight of the number of negative ratings", true);
+	search_rank->add_option("-k,--top", top, "Number of politicians shown", true);
+	add_count_flags(search_rank);
+	search_rank->callback([&weights, &top, &count_only, &exists_only, &db]
+	{
+		// Every politician gets a score, so the ranking holds the top of all of them
+		if(count_only || exists_only)
+		{
+			std::int64_t politicians = db().count_politicians(exists_only);
+			std::cout << std::min(politicians, static_cast<std::int64_t>(top)) << "\n";
+			return;
+		}
+
+		const feature_table features(db().get_politician_stats(), timestamp::now());
+		vector<ranked_politician> ranking;
+		{
+			trace_span span("score");
+			ranking = top_k(features, weights, top);
+		}
+		trace_span span("print");
+		for(std::size_t i = 0; i < ranking.size(); ++i)
+		{
+			const politician_core& p = features.politicians[ranking[i].index];
+			std::cout << i + 1 << ". " << p.name << " (" << p.party << "): "
+			          << ranking[i].score << "\n";
+		}
+		std::cout << ranking.size() << " results returned.\n";
+	});
+
+	setup_phase.reset();
+	parse_start = trace::clock::now();
+	{
+		startup_phase phase("parse/run");
+		CLI11_PARSE(app, argc, argv);
+	}
+
+	{
+		startup_phase phase("close");
+		db_instance.reset();
+	}
+
+	if(profile_startup)
+		startup_profile::print(std::cerr);
+
+	if(query_stats::enabled)
+		query_stats::print(std::cerr);
+
+	if(trace::enabled)
+	{
+		trace::complete("process_input", input_start, trace::clock::now());
+		trace::write(trace_file);
+	}
 
 	return 0;
 }
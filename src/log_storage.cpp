@@ -0,0 +1,680 @@
+// Standard libraries
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+// POSIX
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+// Local headers
+#include <log_storage.hpp>
+#include <exceptions.hpp>
+#include <normalize.hpp>
+#include <timestamp.hpp>
+#include <trace.hpp>
+
+namespace fs = std::filesystem;
+using std::string;
+using std::move;
+
+namespace
+{
+	enum event_type : char
+	{
+		politician_event = 'P',
+		rating_event = 'R',
+		party_event = 'U',
+		delete_event = 'D'
+	};
+
+	// A record is the event's length and checksum followed by the event
+	constexpr std::size_t record_header = 8;
+
+	/** CRC-32C (Castagnoli) of 'size' bytes at 'data' */
+	std::uint32_t crc32c(const char* data, std::size_t size)
+	{
+		static const auto table = []
+		{
+			std::array<std::uint32_t, 256> table{};
+			for(std::uint32_t i = 0; i < 256; ++i)
+			{
+				std::uint32_t crc = i;
+				for(int bit = 0; bit < 8; ++bit)
+					crc = (crc >> 1) ^ (crc & 1 ? 0x82F63B78u : 0);
+				table[i] = crc;
+			}
+			return table;
+		}();
+
+		std::uint32_t crc = 0xFFFFFFFFu;
+		for(std::size_t i = 0; i < size; ++i)
+			crc = (crc >> 8) ^ table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF];
+		return crc ^ 0xFFFFFFFFu;
+	}
+
+	void put_u32(string& out, std::uint32_t value)
+	{
+		for(int byte = 0; byte < 4; ++byte)
+			out += static_cast<char>(value >> (8 * byte));
+	}
+
+	void put_i64(string& out, std::int64_t value)
+	{
+		for(int byte = 0; byte < 8; ++byte)
+			out += static_cast<char>(static_cast<std::uint64_t>(value) >> (8 * byte));
+	}
+
+	void put_string(string& out, const string& value)
+	{
+		put_u32(out, static_cast<std::uint32_t>(value.size()));
+		out += value;
+	}
+
+	/** Frames 'event' as a record, appending it to 'out' */
+	void put_record(string& out, const string& event)
+	{
+		put_u32(out, static_cast<std::uint32_t>(event.size()));
+		put_u32(out, crc32c(event.data(), event.size()));
+		out += event;
+	}
+
+	/** Decodes the fields of an event, throwing if it's shorter than expected */
+	struct event_reader
+	{
+		const string& data;
+		std::size_t pos;
+
+		const char* take(std::size_t size)
+		{
+			if(data.size() - pos < size)
+				throw db_exception("Malformed log event.");
+			pos += size;
+			return data.data() + pos - size;
+		}
+
+		std::uint32_t u32()
+		{
+			const char* bytes = take(4);
+			std::uint32_t value = 0;
+			for(int byte = 3; byte >= 0; --byte)
+				value = (value << 8) | static_cast<unsigned char>(bytes[byte]);
+			return value;
+		}
+
+		std::int64_t i64()
+		{
+			const char* bytes = take(8);
+			std::uint64_t value = 0;
+			for(int byte = 7; byte >= 0; --byte)
+				value = (value << 8) | static_cast<unsigned char>(bytes[byte]);
+			return static_cast<std::int64_t>(value);
+		}
+
+		string str()
+		{
+			std::uint32_t size = u32();
+			return string(take(size), size);
+		}
+	};
+
+	string politician_record(const string& name, const string& party, const string& info)
+	{
+		string event(1, politician_event);
+		put_string(event, name);
+		put_string(event, party);
+		put_string(event, info);
+		return event;
+	}
+
+	string rating_record(const string& name, const string& party, short points,
+			const string& description, std::int64_t date_time)
+	{
+		string event(1, rating_event);
+		put_string(event, name);
+		put_string(event, party);
+		put_i64(event, points);
+		put_string(event, description);
+		put_i64(event, date_time);
+		return event;
+	}
+
+	/** Applies 'event' to 'target' without logging it */
+	void apply_event(const memory_storage& target, const string& event)
+	{
+		event_reader in{event, 1};
+		switch(event.empty() ? 0 : event.front())
+		{
+			case politician_event:
+			{
+				string name = in.str();
+				string party = in.str();
+				string info = in.str();
+				target.memory_storage::insert_to_politician(
+						politician(move(name), party, move(info)));
+				break;
+			}
+
+			case rating_event:
+			{
+				string name = in.str();
+				string party = in.str();
+				short points = static_cast<short>(in.i64());
+				string description = in.str();
+				std::int64_t date_time = in.i64();
+				target.memory_storage::insert_to_ratings(
+						rating(move(name), party, move(description), points, date_time));
+				break;
+			}
+
+			case party_event:
+			{
+				string name = in.str();
+				string party = in.str();
+				string new_party = in.str();
+				target.memory_storage::update_party(
+						politician_update(move(name), party, new_party));
+				break;
+			}
+
+			case delete_event:
+			{
+				string name = in.str();
+				string party = in.str();
+				target.memory_storage::delete_politician(politician_core(move(name), party));
+				break;
+			}
+
+			default:
+				throw db_exception("Unknown log event.");
+		}
+	}
+
+	/**
+	 * Replays the records of 'file' into 'target'.
+	 * @param tolerate_torn_tail stop at the first incomplete or corrupt record
+	 * instead of throwing, as the last segment may end with a torn write
+	 * @return the offset just past the last valid record
+	 */
+	std::uint64_t replay(const string& file, const memory_storage& target,
+			bool tolerate_torn_tail)
+	{
+		std::ifstream in(file, std::ios::binary);
+		if(!in)
+			throw db_exception("Could not open '" + file + "'.");
+		const string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+		std::size_t pos = 0;
+		string event;
+		while(data.size() - pos >= record_header)
+		{
+			event_reader header{data, pos};
+			std::uint32_t size = header.u32();
+			std::uint32_t crc = header.u32();
+			if(data.size() - header.pos < size
+					|| crc32c(data.data() + header.pos, size) != crc)
+				break;
+
+			event.assign(data, header.pos, size);
+			apply_event(target, event);
+			pos = header.pos + size;
+		}
+
+		if(pos != data.size() && !tolerate_torn_tail)
+			throw db_exception("Corrupt record in '" + file + "' at offset "
+					+ std::to_string(pos) + ".");
+		return pos;
+	}
+
+	string numbered_file(const string& dir, const char* prefix, std::uint64_t number,
+			const char* suffix)
+	{
+		char name[64];
+		std::snprintf(name, sizeof(name), "%s-%08llu%s", prefix,
+				static_cast<unsigned long long>(number), suffix);
+		return dir + name;
+	}
+
+	string segment_file(const string& dir, std::uint64_t number)
+	{
+		return numbered_file(dir, "segment", number, ".log");
+	}
+
+	string snapshot_file(const string& dir, std::uint64_t number)
+	{
+		return numbered_file(dir, "snapshot", number, ".snap");
+	}
+
+	/** Numbers of the files named '<prefix>-<number><suffix>' inside 'dir', ascending */
+	vector<std::uint64_t> list_files(const string& dir, const string& prefix,
+			const string& suffix)
+	{
+		vector<std::uint64_t> numbers;
+		for(const fs::directory_entry& entry : fs::directory_iterator(dir))
+		{
+			const string name = entry.path().filename().string();
+			if(name.size() <= prefix.size() + 1 + suffix.size()
+					|| name.compare(0, prefix.size() + 1, prefix + "-") != 0
+					|| name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0)
+				continue;
+
+			const string digits = name.substr(prefix.size() + 1,
+					name.size() - prefix.size() - 1 - suffix.size());
+			if(digits.find_first_not_of("0123456789") == string::npos)
+				numbers.push_back(std::stoull(digits));
+		}
+		std::sort(numbers.begin(), numbers.end());
+		return numbers;
+	}
+
+	void throw_errno(const string& operation, const string& file)
+	{
+		throw db_exception(operation + " error on '" + file + "': " + std::strerror(errno));
+	}
+
+	void write_all(int fd, const string& data, const string& file)
+	{
+		std::size_t written = 0;
+		while(written < data.size())
+		{
+			ssize_t ret = ::write(fd, data.data() + written, data.size() - written);
+			if(ret < 0 && errno == EINTR)
+				continue;
+			if(ret < 0)
+				throw_errno("Write", file);
+			written += static_cast<std::size_t>(ret);
+		}
+	}
+
+	int open_segment(const string& file)
+	{
+		int fd = ::open(file.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+		if(fd < 0)
+			throw_errno("Open", file);
+		return fd;
+	}
+
+	/** Syncs the entries of 'dir', so that the files created or renamed in it persist */
+	void sync_directory(const string& dir)
+	{
+		int dir_fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if(dir_fd >= 0)
+		{
+			::fsync(dir_fd);
+			::close(dir_fd);
+		}
+	}
+
+	/** Opens and locks the LOCK file of 'dir', throwing if another process holds it */
+	int lock_directory(const string& dir)
+	{
+		const string file = dir + "LOCK";
+		int fd = ::open(file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+		if(fd < 0)
+			throw_errno("Open", file);
+
+		if(::flock(fd, LOCK_EX | LOCK_NB) != 0)
+		{
+			const int error = errno;
+			::close(fd);
+			if(error == EWOULDBLOCK)
+				throw db_exception("The log at '" + dir + "' is in use by another process.");
+			errno = error;
+			throw_errno("Lock", file);
+		}
+		return fd;
+	}
+}
+
+log_storage::log_storage(string directory, std::uint64_t segment_size,
+		std::uint64_t compact_after)
+	: dir(directory.empty() || directory.back() == '/' ? directory : directory + '/'),
+		segment_size(segment_size), lock_fd(-1),
+		compact_after(std::max<std::uint64_t>(compact_after, 1)),
+		active_segment(1), active_fd(-1), active_size(0), buffering(false), sealed(0),
+		compacted(0), stopping(false)
+{
+	trace_span span("replay log");
+	fs::create_directories(dir);
+	lock_fd = lock_directory(dir);
+	try
+	{
+		open_log();
+	}
+	catch(...)
+	{
+		if(active_fd >= 0)
+			::close(active_fd);
+		::close(lock_fd);
+		throw;
+	}
+
+	compactor = std::thread(&log_storage::run_compactor, this);
+}
+
+void log_storage::open_log()
+{
+	const vector<std::uint64_t> snapshots = list_files(dir, "snapshot", ".snap");
+	const vector<std::uint64_t> segments = list_files(dir, "segment", ".log");
+
+	std::uint64_t base = 0;
+	if(!snapshots.empty())
+	{
+		base = snapshots.back();
+		replay(snapshot_file(dir, base), *this, false);
+	}
+
+	active_segment = base + 1;
+	for(std::uint64_t number : segments)
+	{
+		const string file = segment_file(dir, number);
+		// Left behind by a compaction interrupted before removing them
+		if(number <= base)
+		{
+			fs::remove(file);
+			continue;
+		}
+
+		const bool last = number == segments.back();
+		std::uint64_t end = replay(file, *this, last);
+		if(last)
+		{
+			if(end != fs::file_size(file))
+				fs::resize_file(file, end);
+			active_segment = number;
+			active_size = end;
+		}
+	}
+	for(std::uint64_t number : snapshots)
+		if(number < base)
+			fs::remove(snapshot_file(dir, number));
+
+	compacted = base;
+	sealed = active_segment - 1;
+	active_fd = open_segment(segment_file(dir, active_segment));
+}
+
+log_storage::~log_storage()
+{
+	{
+		std::lock_guard<std::mutex> lock(compact_mutex);
+		stopping = true;
+	}
+	compact_wake_up.notify_one();
+	compactor.join();
+
+	if(active_fd >= 0)
+	{
+		::fsync(active_fd);
+		::close(active_fd);
+	}
+	::close(lock_fd);
+}
+
+int log_storage::insert_to_politician(const politician& p) const
+{
+	int changes = memory_storage::insert_to_politician(p);
+	if(changes > 0)
+	{
+		try
+		{
+			append(politician_record(p.name, p.party.str(), p.info), false);
+		}
+		catch(...)
+		{
+			memory_storage::delete_politician(p);
+			throw;
+		}
+	}
+	return changes;
+}
+
+int log_storage::insert_to_ratings(const rating& r) const
+{
+	// The event must replay the same timestamp, so it's set before inserting
+	const rating stamped(r.name, r.party, r.description, r.points,
+			r.date_time != 0 ? r.date_time : timestamp::now());
+
+	int changes = memory_storage::insert_to_ratings(stamped);
+	if(changes > 0)
+	{
+		try
+		{
+			append(rating_record(stamped.name, stamped.party.str(), stamped.points,
+					stamped.description, stamped.date_time), true);
+		}
+		catch(...)
+		{
+			remove_rating(find_politician(canonical_key(stamped.name), stamped.party),
+					stamped.date_time);
+			++data_version;
+			throw;
+		}
+	}
+	return changes;
+}
+
+int log_storage::update_party(const politician_update& p) const
+{
+	int changes = memory_storage::update_party(p);
+	if(changes > 0)
+	{
+		string event(1, party_event);
+		put_string(event, p.name);
+		put_string(event, p.party.str());
+		put_string(event, p.new_party.str());
+		try
+		{
+			append(event, false);
+		}
+		catch(...)
+		{
+			memory_storage::update_party(politician_update(p.name, p.new_party, p.party));
+			throw;
+		}
+	}
+	return changes;
+}
+
+int log_storage::delete_politician(const politician_core& p) const
+{
+	if(find_politician(canonical_key(p.name), p.party) == 0)
+		return 0;
+
+	// Logged first, as the deleted ratings couldn't be put back if that failed
+	string event(1, delete_event);
+	put_string(event, p.name);
+	put_string(event, p.party.str());
+	append(event, false);
+	return memory_storage::delete_politician(p);
+}
+
+void log_storage::bulk_load(const std::function<void()>& load) const
+{
+	// Ratings are the only changes a failed bulk load undoes, so only their events
+	// wait for it to succeed
+	buffering = true;
+	pending.clear();
+	try
+	{
+		// Written as part of the load, so that its ratings are undone if that fails
+		memory_storage::bulk_load([this, &load]
+		{
+			load();
+			buffering = false;
+			trace_span span("append");
+			write_records(pending);
+		});
+	}
+	catch(...)
+	{
+		buffering = false;
+		pending.clear();
+		throw;
+	}
+	pending.clear();
+}
+
+void log_storage::append(const string& event, bool deferrable) const
+{
+	if(buffering && deferrable)
+	{
+		put_record(pending, event);
+		return;
+	}
+
+	string record;
+	put_record(record, event);
+	write_records(record);
+}
+
+void log_storage::write_records(const string& records) const
+{
+	if(active_fd < 0)
+		throw db_exception("The log at '" + dir + "' can't be written after a failed write.");
+
+	const string file = segment_file(dir, active_segment);
+	try
+	{
+		write_all(active_fd, records, file);
+		if(::fdatasync(active_fd) != 0)
+			throw_errno("Sync", file);
+	}
+	catch(...)
+	{
+		// A torn record would hide the ones appended after it from the replay
+		if(::ftruncate(active_fd, static_cast<off_t>(active_size)) != 0)
+		{
+			::close(active_fd);
+			active_fd = -1;
+		}
+		throw;
+	}
+	active_size += records.size();
+	if(active_size < segment_size)
+		return;
+
+	// The records are durable by now, so failing to seal the segment doesn't fail
+	// their append: the segment keeps growing and the next append tries again
+	try
+	{
+		seal_segment();
+	}
+	catch(const std::exception& e)
+	{
+		std::cerr << "Log segment sealing failed: " << e.what() << "\n";
+	}
+}
+
+void log_storage::seal_segment() const
+{
+	const string file = segment_file(dir, active_segment);
+	if(::fsync(active_fd) != 0)
+		throw_errno("Sync", file);
+
+	// The next segment is opened before the active one is closed, so that a failure
+	// leaves the active one in place
+	int next_fd = open_segment(segment_file(dir, active_segment + 1));
+	sync_directory(dir);
+	::close(active_fd);
+	active_fd = next_fd;
+	{
+		std::lock_guard<std::mutex> lock(compact_mutex);
+		sealed = active_segment;
+	}
+	compact_wake_up.notify_one();
+
+	++active_segment;
+	active_size = 0;
+}
+
+void log_storage::run_compactor()
+{
+	std::unique_lock<std::mutex> lock(compact_mutex);
+	std::uint64_t due = compacted + compact_after;
+	while(true)
+	{
+		compact_wake_up.wait(lock, [this, due] { return stopping || sealed >= due; });
+		if(stopping)
+			return;
+
+		const std::uint64_t last = sealed;
+		lock.unlock();
+		try
+		{
+			compact(last);
+		}
+		catch(const std::exception& e)
+		{
+			// The segments stay in place, so nothing is lost
+			std::cerr << "Log compaction failed: " << e.what() << "\n";
+		}
+		lock.lock();
+		due = last + compact_after;
+	}
+}
+
+void log_storage::compact(std::uint64_t last)
+{
+	trace_span span("compact");
+
+	// Rebuilt from the files alone, the live data keeps changing meanwhile
+	const std::uint64_t base = compacted;
+	memory_storage state;
+	if(base > 0)
+		replay(snapshot_file(dir, base), state, false);
+	for(std::uint64_t number = base + 1; number <= last; ++number)
+		replay(segment_file(dir, number), state, false);
+
+	vector<std::int64_t> ids;
+	ids.reserve(state.politicians.size());
+	for(const auto& [id, p] : state.politicians)
+		ids.push_back(id);
+	std::sort(ids.begin(), ids.end());
+
+	string records;
+	for(std::int64_t id : ids)
+	{
+		const memory_storage::stored_politician& p = state.politicians.at(id);
+		const string& party = state.parties[p.party_id].str();
+		put_record(records, politician_record(p.name, party, p.info));
+		for(const memory_storage::stored_rating& r : p.ratings)
+			put_record(records, rating_record(p.name, party, r.points, r.description,
+					r.date_time));
+	}
+
+	// Written aside and renamed, so that a snapshot is either complete or absent
+	const string file = snapshot_file(dir, last);
+	const string temporary = file + ".tmp";
+	int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if(fd < 0)
+		throw_errno("Open", temporary);
+	try
+	{
+		write_all(fd, records, temporary);
+		if(::fsync(fd) != 0)
+			throw_errno("Sync", temporary);
+	}
+	catch(...)
+	{
+		::close(fd);
+		fs::remove(temporary);
+		throw;
+	}
+	::close(fd);
+	fs::rename(temporary, file);
+	sync_directory(dir);
+	compacted = last;
+
+	for(std::uint64_t number = base + 1; number <= last; ++number)
+		fs::remove(segment_file(dir, number));
+	if(base > 0)
+		fs::remove(snapshot_file(dir, base));
+}
@@ -7,16 +7,18 @@
 // Local headers
 #include <input.hpp>
 #include <exceptions.hpp>
+#include <profile.hpp>
 
 int main(int argc, char** argv)
 {
+	startup_profile::start();
+
 	// Better performance when using only C++ stdin/stdout
 	std::ios_base::sync_with_stdio(false);
 
 	try
 	{
-		database db;
-		return process_input(argc, argv, db);
+		return process_input(argc, argv);
 	}
 	catch(const db_exception& e)
 	{
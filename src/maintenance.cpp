@@ -0,0 +1,281 @@
+// Standard libraries
+#include <algorithm>
+#include <exception>
+#include <map>
+#include <optional>
+#include <set>
+#include <thread>
+
+// Local headers
+#include <database.hpp>
+#include <exceptions.hpp>
+#include <trace.hpp>
+
+using std::move;
+using std::string;
+using std::vector;
+
+namespace
+{
+	/** Actual aggregates of a party, or the share of a range of politicians in them */
+	struct party_aggregates
+	{
+		std::int64_t members = 0;
+		std::int64_t total = 0;
+		rating_histogram histogram;
+	};
+
+	using party_map = std::map<sqlite3_int64, party_aggregates>;
+
+	/** Drifts of a range of politicians, and its share in the aggregates of the parties */
+	struct range_result
+	{
+		vector<aggregate_drift> drifts;
+		party_map parties;
+	};
+
+	/** Checks the politicians with ids in [first, last], over a new connection */
+	range_result verify_range(const char* db_file, sqlite3_int64 first, sqlite3_int64 last)
+	{
+		trace_span span("verify range");
+		const string function_name = "verify_range";
+
+		sqlite3* connection;
+		int ret = sqlite3_open_v2(db_file, &connection,
+				SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr);
+		if(ret != SQLITE_OK)
+		{
+			db_exception e("Database opening", function_name, ret, sqlite3_errmsg(connection));
+			sqlite3_close(connection);
+			throw e;
+		}
+
+		range_result result;
+		sqlite3_stmt* stmt = nullptr;
+		ret = sqlite3_prepare_v2(connection, sql_strings::verify_politicians, -1, &stmt, nullptr);
+		if(ret == SQLITE_OK)
+		{
+			sqlite3_bind_int64(stmt, 1, first);
+			sqlite3_bind_int64(stmt, 2, last);
+			while((ret = sqlite3_step(stmt)) == SQLITE_ROW)
+			{
+				const short points = static_cast<short>(sqlite3_column_int(stmt, 5));
+				const sqlite3_int64 actual = sqlite3_column_int64(stmt, 7);
+				switch(sqlite3_column_int(stmt, 8))
+				{
+					case 2:
+						result.parties[sqlite3_column_int64(stmt, 1)].members += actual;
+						break;
+
+					case 3:
+					{
+						party_aggregates& party = result.parties[sqlite3_column_int64(stmt, 1)];
+						party.total += points * actual;
+						party.histogram[points] += actual;
+						break;
+					}
+
+					default:
+						result.drifts.push_back(aggregate_drift{
+								sqlite3_column_int64(stmt, 0),
+								sqlite3_column_int64(stmt, 1),
+								(const char*) sqlite3_column_text(stmt, 2),
+								(const char*) sqlite3_column_text(stmt, 3),
+								(const char*) sqlite3_column_text(stmt, 4),
+								points,
+								sqlite3_column_int64(stmt, 6),
+								actual});
+				}
+			}
+		}
+
+		std::exception_ptr error;
+		if(ret != SQLITE_DONE)
+			error = std::make_exception_ptr(db_exception("Verify", function_name, ret,
+					sqlite3_errmsg(connection)));
+		sqlite3_finalize(stmt);
+		sqlite3_close(connection);
+		if(error)
+			std::rethrow_exception(error);
+
+		return result;
+	}
+
+	/**
+	 * Compares the stored aggregates of every party with the 'actual' ones the workers
+	 * added up, over the connection of 'db'.
+	 */
+	void verify_parties(const database& db, const party_map& actual, verify_report& report)
+	{
+		trace_span span("verify parties");
+		const string function_name = "verify_parties";
+
+		// Only the counts within the bounds of the points can be stored
+		std::map<sqlite3_int64, rating_histogram> stored_histograms;
+		{
+			sqlite_stmt_obj stmt(db.connection, sql_strings::verify_party_histograms,
+					function_name);
+			int ret;
+			while((ret = sqlite3_step(stmt.ppStmt)) == SQLITE_ROW)
+			{
+				const int points = sqlite3_column_int(stmt.ppStmt, 1);
+				if(points < rating_histogram::min_points || points > rating_histogram::max_points)
+					continue;
+				rating_histogram& stored = stored_histograms[sqlite3_column_int64(stmt.ppStmt, 0)];
+				stored[static_cast<short>(points)] = sqlite3_column_int64(stmt.ppStmt, 2);
+			}
+			if(ret != SQLITE_DONE)
+				throw db_exception("Verify", function_name, ret, sqlite3_errmsg(db.connection));
+		}
+
+		const party_aggregates none;
+		const rating_histogram empty;
+		sqlite_stmt_obj stmt(db.connection, sql_strings::verify_party_aggregates, function_name);
+		int ret;
+		while((ret = sqlite3_step(stmt.ppStmt)) == SQLITE_ROW)
+		{
+			++report.parties;
+			const sqlite3_int64 id = sqlite3_column_int64(stmt.ppStmt, 0);
+			const string name = (const char*) sqlite3_column_text(stmt.ppStmt, 1);
+			auto found = actual.find(id);
+			const party_aggregates& party = found != actual.end() ? found->second : none;
+			auto drift = [&report, id, &name](const char* aggregate, short points,
+					std::int64_t stored, std::int64_t recounted)
+			{
+				if(stored != recounted)
+					report.drifts.push_back(
+							aggregate_drift{0, id, "", name, aggregate, points, stored, recounted});
+			};
+
+			drift("member_count", 0, sqlite3_column_int64(stmt.ppStmt, 2), party.members);
+			drift("total_rating", 0, sqlite3_column_int64(stmt.ppStmt, 3), party.total);
+			auto histogram = stored_histograms.find(id);
+			const rating_histogram& stored = histogram != stored_histograms.end()
+				? histogram->second : empty;
+			for(short points = rating_histogram::min_points;
+					points <= rating_histogram::max_points; ++points)
+				drift("histogram", points, stored[points], party.histogram[points]);
+		}
+		if(ret != SQLITE_DONE)
+			throw db_exception("Verify", function_name, ret, sqlite3_errmsg(db.connection));
+	}
+
+	/** The statement storing the actual value of 'drift' */
+	const char* fix_statement(const aggregate_drift& drift)
+	{
+		if(drift.politician_id != 0)
+			return drift.aggregate == "histogram" ? sql_strings::fix_politician_histogram
+				: sql_strings::fix_total;
+		if(drift.aggregate == "histogram")
+			return sql_strings::fix_party_histogram;
+		return drift.aggregate == "member_count" ? sql_strings::fix_member_count
+			: sql_strings::fix_party_total;
+	}
+}
+
+verify_report database::verify_totals(unsigned threads, bool fix) const
+{
+	const database& db = *this;
+	const string function_name = "verify_totals";
+
+	// Keeps other connections from writing while the workers read, so that they
+	// all see the same data, which the fixes are then applied to
+	db_transaction transaction(db, "BEGIN IMMEDIATE;");
+
+	verify_report report{0, 0, {}};
+	sqlite3_int64 first_id = 0, last_id = -1;
+	{
+		sqlite_stmt_obj stmt(db.connection, sql_strings::politician_id_range, function_name);
+		int ret = sqlite3_step(stmt.ppStmt);
+		if(ret != SQLITE_ROW)
+			throw db_exception("Search", function_name, ret, sqlite3_errmsg(db.connection));
+		report.politicians = sqlite3_column_int64(stmt.ppStmt, 0);
+		if(report.politicians > 0)
+		{
+			first_id = sqlite3_column_int64(stmt.ppStmt, 1);
+			last_id = sqlite3_column_int64(stmt.ppStmt, 2);
+		}
+	}
+
+	const char* db_file = sqlite3_db_filename(db.connection, "main");
+	const sqlite3_int64 span = last_id - first_id + 1;
+	threads = static_cast<unsigned>(std::clamp<sqlite3_int64>(threads, 0, span));
+	const sqlite3_int64 range = threads > 0 ? (span + threads - 1) / threads : 0;
+
+	vector<range_result> results(threads);
+	vector<std::exception_ptr> errors(threads);
+	vector<std::thread> workers;
+	for(unsigned i = 0; i < threads; ++i)
+	{
+		const sqlite3_int64 first = first_id + i * range;
+		const sqlite3_int64 last = std::min(first + range - 1, last_id);
+		workers.emplace_back([&results, &errors, i, db_file, first, last]
+		{
+			try
+			{
+				results[i] = verify_range(db_file, first, last);
+			}
+			catch(...)
+			{
+				errors[i] = std::current_exception();
+			}
+		});
+	}
+	for(std::thread& worker : workers)
+		worker.join();
+
+	// The politicians go first, in the order of their ranges, and the shares of the
+	// ranges in the aggregates of each party are added up
+	party_map parties;
+	for(unsigned i = 0; i < threads; ++i)
+	{
+		if(errors[i])
+			std::rethrow_exception(errors[i]);
+		move(results[i].drifts.begin(), results[i].drifts.end(),
+				std::back_inserter(report.drifts));
+		for(const auto& [id, share] : results[i].parties)
+		{
+			party_aggregates& party = parties[id];
+			party.members += share.members;
+			party.total += share.total;
+			for(std::size_t j = 0; j < party.histogram.counts.size(); ++j)
+				party.histogram.counts[j] += share.histogram.counts[j];
+		}
+	}
+	verify_parties(db, parties, report);
+
+	if(fix && !report.drifts.empty())
+	{
+		trace_span span("fix");
+		auto store = [&db, &function_name](const char* sql, sqlite3_int64 id,
+				std::int64_t value, std::optional<short> points)
+		{
+			sqlite_stmt_obj stmt(db, sql, function_name);
+			sqlite3_bind_int64(stmt.ppStmt, 1, value);
+			sqlite3_bind_int64(stmt.ppStmt, 2, id);
+			if(points)
+				sqlite3_bind_int(stmt.ppStmt, 3, *points);
+			int ret = sqlite3_step(stmt.ppStmt);
+			if(ret != SQLITE_DONE)
+				throw db_exception("Update", function_name, ret, sqlite3_errmsg(db.connection));
+		};
+
+		// Fixing the total_rating of a politician also moves the total of its party,
+		// so those parties get their actual total again afterwards, drift or not
+		std::set<sqlite3_int64> moved_totals;
+		for(const aggregate_drift& drift : report.drifts)
+		{
+			const bool histogram = drift.aggregate == "histogram";
+			store(fix_statement(drift), drift.politician_id != 0 ? drift.politician_id
+					: drift.party_id, drift.actual,
+					histogram ? std::optional<short>(drift.points) : std::nullopt);
+			if(drift.politician_id != 0 && !histogram)
+				moved_totals.insert(drift.party_id);
+		}
+		for(sqlite3_int64 id : moved_totals)
+			store(sql_strings::fix_party_total, id, parties[id].total, std::nullopt);
+	}
+	transaction.commit();
+
+	return report;
+}
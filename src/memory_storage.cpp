@@ -0,0 +1,902 @@
+// Standard libraries
+#include <algorithm>
+#include <stdexcept>
+
+// External libraries
+#include <sqlite3.h>
+
+// Local headers
+#include <memory_storage.hpp>
+#include <exceptions.hpp>
+#include <normalize.hpp>
+#include <stats.hpp>
+#include <timestamp.hpp>
+
+using std::string;
+using std::move;
+
+namespace
+{
+	/** Orders ratings by date/time */
+	bool earlier(const memory_storage::stored_rating& r, std::int64_t date_time)
+	{
+		return r.date_time < date_time;
+	}
+
+	/** Removes 'id' from the sorted 'ids' */
+	void erase_id(vector<std::int64_t>& ids, std::int64_t id)
+	{
+		auto it = std::lower_bound(ids.begin(), ids.end(), id);
+		if(it != ids.end() && *it == id)
+			ids.erase(it);
+	}
+
+	/** Inserts 'id' into the sorted 'ids' */
+	void insert_id(vector<std::int64_t>& ids, std::int64_t id)
+	{
+		ids.insert(std::upper_bound(ids.begin(), ids.end(), id), id);
+	}
+}
+
+memory_storage::memory_storage()
+	: next_politician_id(1), data_version(0), bulk_loading(false)
+{}
+
+std::size_t memory_storage::find_party(const string& party_key) const
+{
+	auto it = party_ids.find(party_key);
+	return it == party_ids.end() ? parties.size() : it->second;
+}
+
+std::size_t memory_storage::find_or_add_party(const party_handle& party) const
+{
+	std::size_t party_id = find_party(party.key());
+	if(party_id == parties.size())
+	{
+		parties.push_back(party);
+		party_totals.push_back(0);
+		party_histograms.emplace_back();
+		politicians_by_party.emplace_back();
+		party_ids.emplace(party.key(), party_id);
+	}
+	return party_id;
+}
+
+std::int64_t memory_storage::find_politician(const string& name_key,
+		const party_handle& party) const
+{
+	std::size_t party_id = find_party(party.key());
+	auto it = politicians_by_name.find(name_key);
+	if(party_id == parties.size() || it == politicians_by_name.end())
+		return 0;
+
+	for(std::int64_t id : it->second)
+		if(politicians.at(id).party_id == party_id)
+			return id;
+	return 0;
+}
+
+void memory_storage::remove_rating(std::int64_t id, std::int64_t date_time) const
+{
+	stored_politician& p = politicians.at(id);
+	auto r = std::lower_bound(p.ratings.begin(), p.ratings.end(), date_time, earlier);
+	p.total_rating -= r->points;
+	party_totals[p.party_id] -= r->points;
+	--p.histogram[r->points];
+	--party_histograms[p.party_id][r->points];
+	ratings_by_date.erase({date_time, id});
+	p.ratings.erase(r);
+}
+
+int memory_storage::insert_to_politician(const politician& p) const
+{
+	static query_counters counters("memory_storage::insert_to_politician");
+	query_timer timer(counters);
+
+	string name_key = canonical_key(p.name);
+	if(find_politician(name_key, p.party) != 0)
+		throw politician_op_exception("Insert", "insert_to_politician",
+				SQLITE_CONSTRAINT_UNIQUE, nullptr);
+
+	// The party is created along with its first politician
+	std::size_t party_id = find_or_add_party(p.party);
+
+	std::int64_t id = next_politician_id++;
+	politicians_by_name[name_key].push_back(id);
+	politicians_by_party[party_id].push_back(id);
+	// Like the sqlite engine, the total only counts the ratings
+	politicians.emplace(id, stored_politician{p.name, move(name_key), party_id, p.info,
+			0, {}, {}});
+	++data_version;
+
+	timer.add_rows(1);
+	return 1;
+}
+
+int memory_storage::insert_to_ratings(const rating& r) const
+{
+	const string function_name = "insert_to_ratings";
+	static query_counters counters("memory_storage::insert_to_ratings");
+	query_timer timer(counters);
+
+	if(r.points < -5 || r.points > 5)
+		throw rating_op_exception("Insert", function_name, SQLITE_CONSTRAINT_CHECK, nullptr);
+
+	std::int64_t id = find_politician(canonical_key(r.name), r.party);
+	if(id == 0)
+		throw rating_op_exception("Insert", function_name, SQLITE_CONSTRAINT_FOREIGNKEY, nullptr);
+	stored_politician& p = politicians.at(id);
+
+	std::int64_t date_time = r.date_time != 0 ? r.date_time : timestamp::now();
+	auto it = std::lower_bound(p.ratings.begin(), p.ratings.end(), date_time, earlier);
+	if(it != p.ratings.end() && it->date_time == date_time)
+		throw rating_op_exception("Insert", function_name, SQLITE_CONSTRAINT_PRIMARYKEY, nullptr);
+
+	p.ratings.insert(it, stored_rating{date_time, r.points, r.description});
+	ratings_by_date.emplace(date_time, id);
+	p.total_rating += r.points;
+	party_totals[p.party_id] += r.points;
+	++p.histogram[r.points];
+	++party_histograms[p.party_id][r.points];
+	if(bulk_loading)
+		bulk_loaded.emplace_back(id, date_time);
+	++data_version;
+
+	timer.add_rows(1);
+	return 1;
+}
+
+int memory_storage::update_party(const politician_update& p) const
+{
+	static query_counters counters("memory_storage::update_party");
+	query_timer timer(counters);
+
+	const string name_key = canonical_key(p.name);
+	std::int64_t id = find_politician(name_key, p.party);
+	if(id == 0)
+		return 0;
+	if(p.new_party.key() != p.party.key() && find_politician(name_key, p.new_party) != 0)
+		throw politician_op_exception("Update", "update_party", SQLITE_CONSTRAINT_UNIQUE,
+				nullptr);
+
+	std::size_t new_party_id = find_or_add_party(p.new_party);
+
+	stored_politician& politician = politicians.at(id);
+	erase_id(politicians_by_party[politician.party_id], id);
+	insert_id(politicians_by_party[new_party_id], id);
+	party_totals[politician.party_id] -= politician.total_rating;
+	party_totals[new_party_id] += politician.total_rating;
+	for(std::size_t i = 0; i < politician.histogram.counts.size(); ++i)
+	{
+		party_histograms[politician.party_id].counts[i] -= politician.histogram.counts[i];
+		party_histograms[new_party_id].counts[i] += politician.histogram.counts[i];
+	}
+	politician.party_id = new_party_id;
+	++data_version;
+
+	timer.add_rows(1);
+	return 1;
+}
+
+int memory_storage::delete_politician(const politician_core& p) const
+{
+	static query_counters counters("memory_storage::delete_politician");
+	query_timer timer(counters);
+
+	const string name_key = canonical_key(p.name);
+	std::int64_t id = find_politician(name_key, p.party);
+	if(id == 0)
+		return 0;
+
+	auto it = politicians.find(id);
+	erase_id(politicians_by_party[it->second.party_id], id);
+	party_totals[it->second.party_id] -= it->second.total_rating;
+	for(std::size_t i = 0; i < it->second.histogram.counts.size(); ++i)
+		party_histograms[it->second.party_id].counts[i] -= it->second.histogram.counts[i];
+	for(const stored_rating& r : it->second.ratings)
+		ratings_by_date.erase({r.date_time, id});
+	vector<std::int64_t>& homonyms = politicians_by_name[name_key];
+	erase_id(homonyms, id);
+	if(homonyms.empty())
+		politicians_by_name.erase(name_key);
+	politicians.erase(it);
+	++data_version;
+
+	timer.add_rows(1);
+	return 1;
+}
+
+const vector<politician> memory_storage::get_politician_by_name(const string& name) const
+{
+	static query_counters counters("memory_storage::get_politician_by_name");
+	query_timer timer(counters);
+
+	vector<politician> result;
+	auto it = politicians_by_name.find(canonical_key(name));
+	if(it == politicians_by_name.end())
+		return result;
+
+	for(std::int64_t id : it->second)
+	{
+		const stored_politician& p = politicians.at(id);
+		timer.add_row(p.name.size() + sizeof(party_handle) + p.info.size() + sizeof(int));
+		result.emplace_back(p.name, parties[p.party_id], p.info,
+				static_cast<short>(p.total_rating));
+	}
+	return result;
+}
+
+const vector<politician> memory_storage::get_politicians_by_party(const string& party) const
+{
+	static query_counters counters("memory_storage::get_politicians_by_party");
+	query_timer timer(counters);
+
+	vector<politician> result;
+	std::size_t party_id = find_party(canonical_key(party));
+	if(party_id == parties.size())
+		return result;
+
+	for(std::int64_t id : politicians_by_party[party_id])
+	{
+		const stored_politician& p = politicians.at(id);
+		timer.add_row(p.name.size() + sizeof(party_handle) + p.info.size() + sizeof(int));
+		result.emplace_back(p.name, parties[party_id], p.info,
+				static_cast<short>(p.total_rating));
+	}
+	return result;
+}
+
+const vector<rating> memory_storage::get_politician_ratings(const politician_core& p) const
+{
+	static query_counters counters("memory_storage::get_politician_ratings");
+	query_timer timer(counters);
+
+	vector<rating> result;
+	std::int64_t id = find_politician(canonical_key(p.name), p.party);
+	if(id == 0)
+		return result;
+
+	const stored_politician& politician = politicians.at(id);
+	result.reserve(politician.ratings.size());
+	for(const stored_rating& r : politician.ratings)
+	{
+		timer.add_row(politician.name.size() + sizeof(party_handle) + r.description.size()
+				+ sizeof(r.date_time) + sizeof(int));
+		result.emplace_back(politician.name, parties[politician.party_id], r.description,
+				r.points, r.date_time);
+	}
+	return result;
+}
+
+const vector<std::optional<politician>> memory_storage::get_politicians_batch(
+		const vector<politician_core>& keys) const
+{
+	static query_counters counters("memory_storage::get_politicians_batch");
+	query_timer timer(counters);
+
+	vector<std::optional<politician>> result(keys.size());
+	for(std::size_t i = 0; i < keys.size(); ++i)
+	{
+		std::int64_t id = find_politician(canonical_key(keys[i].name), keys[i].party);
+		if(id == 0)
+			continue;
+
+		const stored_politician& p = politicians.at(id);
+		timer.add_row(p.name.size() + sizeof(party_handle) + p.info.size() + sizeof(int));
+		result[i].emplace(p.name, parties[p.party_id], p.info,
+				static_cast<short>(p.total_rating));
+	}
+	return result;
+}
+
+const vector<vector<rating>> memory_storage::get_ratings_batch(
+		const vector<politician_core>& keys) const
+{
+	static query_counters counters("memory_storage::get_ratings_batch");
+	query_timer timer(counters);
+
+	vector<vector<rating>> result(keys.size());
+	for(std::size_t i = 0; i < keys.size(); ++i)
+	{
+		std::int64_t id = find_politician(canonical_key(keys[i].name), keys[i].party);
+		if(id == 0)
+			continue;
+
+		const stored_politician& politician = politicians.at(id);
+		result[i].reserve(politician.ratings.size());
+		for(const stored_rating& r : politician.ratings)
+		{
+			timer.add_row(politician.name.size() + sizeof(party_handle) + r.description.size()
+					+ sizeof(r.date_time) + sizeof(int));
+			result[i].emplace_back(politician.name, parties[politician.party_id], r.description,
+					r.points, r.date_time);
+		}
+	}
+	return result;
+}
+
+const vector<rating> memory_storage::get_ratings_in_range(const politician_core& p,
+		const rating_range& range) const
+{
+	static query_counters counters("memory_storage::get_ratings_in_range");
+	query_timer timer(counters);
+
+	vector<rating> result;
+	std::int64_t id = find_politician(canonical_key(p.name), p.party);
+	if(id == 0)
+		return result;
+
+	const stored_politician& politician = politicians.at(id);
+	auto first = std::lower_bound(politician.ratings.begin(), politician.ratings.end(),
+			range.from, earlier);
+	auto last = std::lower_bound(first, politician.ratings.end(), range.to, earlier);
+	std::size_t count = static_cast<std::size_t>(last - first);
+	if(range.limit != 0)
+		count = std::min(count, range.limit);
+
+	result.reserve(count);
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		const stored_rating& r = range.descending ? *(last - 1 - static_cast<std::ptrdiff_t>(i))
+			: *(first + static_cast<std::ptrdiff_t>(i));
+		timer.add_row(politician.name.size() + sizeof(party_handle) + r.description.size()
+				+ sizeof(r.date_time) + sizeof(int));
+		result.emplace_back(politician.name, parties[politician.party_id], r.description,
+				r.points, r.date_time);
+	}
+	return result;
+}
+
+const vector<rating> memory_storage::get_all_ratings_in_range(const rating_range& range) const
+{
+	static query_counters counters("memory_storage::get_all_ratings_in_range");
+	query_timer timer(counters);
+
+	vector<rating> result;
+	const auto add = [&](const std::pair<std::int64_t, std::int64_t>& key)
+	{
+		const stored_politician& politician = politicians.at(key.second);
+		const stored_rating& r = *std::lower_bound(politician.ratings.begin(),
+				politician.ratings.end(), key.first, earlier);
+		timer.add_row(politician.name.size() + sizeof(party_handle) + r.description.size()
+				+ sizeof(r.date_time) + sizeof(int));
+		result.emplace_back(politician.name, parties[politician.party_id], r.description,
+				r.points, r.date_time);
+		return range.limit == 0 || result.size() < range.limit;
+	};
+
+	// Politician ids start at 1, so 0 comes before every rating of a date/time
+	auto first = ratings_by_date.lower_bound({range.from, 0});
+	auto last = ratings_by_date.lower_bound({range.to, 0});
+	if(range.descending)
+	{
+		while(last != first && add(*--last))
+			continue;
+	}
+	else
+	{
+		while(first != last && add(*first++))
+			continue;
+	}
+	return result;
+}
+
+vector<const memory_storage::stored_politician*> memory_storage::sorted_politicians(
+		const string& order, const string& function_name) const
+{
+	if(order != "ASC" && order != "DESC")
+		throw std::domain_error(
+				"'order' parameter of function '" + function_name + "' not satisfed.\n"
+				"Expected: [DESC | ASC]. Got: " + order);
+
+	vector<const stored_politician*> sorted;
+	sorted.reserve(politicians.size());
+	for(const auto& [id, p] : politicians)
+		sorted.push_back(&p);
+
+	const bool descending = order == "DESC";
+	std::sort(sorted.begin(), sorted.end(),
+			[this, descending](const stored_politician* a, const stored_politician* b)
+	{
+		if(a->total_rating != b->total_rating)
+			return descending ? a->total_rating > b->total_rating
+				: a->total_rating < b->total_rating;
+		if(a->name != b->name)
+			return a->name < b->name;
+		return parties[a->party_id].str() < parties[b->party_id].str();
+	});
+	return sorted;
+}
+
+const vector<politician> memory_storage::get_all_politicians(const string& order) const
+{
+	static query_counters counters("memory_storage::get_all_politicians");
+	query_timer timer(counters);
+
+	vector<politician> result;
+	vector<const stored_politician*> sorted = sorted_politicians(order, "get_all_politicians");
+	result.reserve(sorted.size());
+	for(const stored_politician* p : sorted)
+	{
+		timer.add_row(p->name.size() + sizeof(party_handle) + p->info.size() + sizeof(int));
+		result.emplace_back(p->name, parties[p->party_id], p->info,
+				static_cast<short>(p->total_rating));
+	}
+	return result;
+}
+
+const vector<politician_core> memory_storage::get_politicians_compact(const string& order) const
+{
+	static query_counters counters("memory_storage::get_politicians_compact");
+	query_timer timer(counters);
+
+	vector<politician_core> result;
+	vector<const stored_politician*> sorted = sorted_politicians(order,
+			"get_politicians_compact");
+	result.reserve(sorted.size());
+	for(const stored_politician* p : sorted)
+	{
+		timer.add_row(p->name.size() + sizeof(party_handle));
+		result.emplace_back(p->name, parties[p->party_id]);
+	}
+	return result;
+}
+
+void memory_storage::for_each_politician_with_ratings(std::size_t latest,
+		const string& order, const politician_visitor& visit) const
+{
+	static query_counters counters("memory_storage::for_each_politician_with_ratings");
+	query_timer timer(counters);
+
+	vector<rating> ratings;
+	for(const stored_politician* p : sorted_politicians(order,
+			"for_each_politician_with_ratings"))
+	{
+		const party_handle party = parties[p->party_id];
+		timer.add_row(p->name.size() + sizeof(party_handle) + p->info.size() + sizeof(int));
+
+		ratings.clear();
+		const std::size_t count = std::min(latest, p->ratings.size());
+		for(auto r = p->ratings.rbegin(); r != p->ratings.rbegin()
+				+ static_cast<std::ptrdiff_t>(count); ++r)
+		{
+			timer.add_row(r->description.size() + sizeof(r->date_time) + sizeof(int));
+			ratings.emplace_back(p->name, party, r->description, r->points, r->date_time);
+		}
+		visit(politician(p->name, party, p->info, static_cast<short>(p->total_rating)),
+				ratings);
+	}
+}
+
+const vector<projected_politician> memory_storage::get_politicians_projected(
+		const vector<politician_field>& fields, const string& order) const
+{
+	static query_counters counters("memory_storage::get_politicians_projected");
+	query_timer timer(counters);
+
+	vector<projected_politician> result;
+	vector<const stored_politician*> sorted = sorted_politicians(order,
+			"get_politicians_projected");
+	result.reserve(sorted.size());
+	for(const stored_politician* p : sorted)
+	{
+		projected_politician& projected = result.emplace_back();
+		std::size_t size = 0;
+		for(politician_field field : fields)
+		{
+			switch(field)
+			{
+				case politician_field::name:
+					projected.name = p->name;
+					size += p->name.size();
+					break;
+				case politician_field::party:
+					projected.party = parties[p->party_id];
+					size += sizeof(party_handle);
+					break;
+				case politician_field::information:
+					projected.info = p->info;
+					size += p->info.size();
+					break;
+				case politician_field::points:
+					projected.points = p->total_rating;
+					size += sizeof(projected.points);
+					break;
+				case politician_field::ratings:
+					projected.ratings = p->histogram.ratings();
+					size += sizeof(projected.ratings);
+					break;
+			}
+		}
+		timer.add_row(size);
+	}
+	return result;
+}
+
+bool memory_storage::matches(const filter_expression& filter, const stored_politician& p) const
+{
+	using kind = filter_expression::kind;
+	switch(filter.type)
+	{
+		case kind::all:
+			return std::all_of(filter.operands.begin(), filter.operands.end(),
+					[this, &p](const filter_expression& operand) { return matches(operand, p); });
+
+		case kind::any:
+			return std::any_of(filter.operands.begin(), filter.operands.end(),
+					[this, &p](const filter_expression& operand) { return matches(operand, p); });
+
+		case kind::negation:
+			return !matches(filter.operands.front(), p);
+
+		case kind::rated_since:
+			return !p.ratings.empty() && p.ratings.back().date_time >= filter.number;
+
+		case kind::rated_before:
+			return !p.ratings.empty() && p.ratings.front().date_time < filter.number;
+
+		case kind::comparison:
+			break;
+	}
+
+	if(filter.field == filter_field::name || filter.field == filter_field::party)
+	{
+		const string& key = filter.field == filter_field::name ? p.name_key
+			: parties[p.party_id].key();
+		return (key == filter.text) == (filter.op == filter_op::equal);
+	}
+
+	const std::int64_t value = filter.field == filter_field::points ? p.total_rating
+		: p.histogram.ratings();
+	switch(filter.op)
+	{
+		case filter_op::equal: return value == filter.number;
+		case filter_op::not_equal: return value != filter.number;
+		case filter_op::less: return value < filter.number;
+		case filter_op::less_equal: return value <= filter.number;
+		case filter_op::greater: return value > filter.number;
+		case filter_op::greater_equal: return value >= filter.number;
+	}
+	return false;
+}
+
+const vector<politician> memory_storage::get_politicians_where(
+		const filter_expression& filter) const
+{
+	static query_counters counters("memory_storage::get_politicians_where");
+	query_timer timer(counters);
+
+	vector<politician> result;
+	for(const stored_politician* p : sorted_politicians("DESC", "get_politicians_where"))
+	{
+		if(!matches(filter, *p))
+			continue;
+		timer.add_row(p->name.size() + sizeof(party_handle) + p->info.size() + sizeof(int));
+		result.emplace_back(p->name, parties[p->party_id], p->info,
+				static_cast<short>(p->total_rating));
+	}
+	return result;
+}
+
+std::int64_t memory_storage::count_politicians_by_name(const string& name, bool exists) const
+{
+	static query_counters counters("memory_storage::count_politicians_by_name");
+	query_timer timer(counters);
+
+	auto it = politicians_by_name.find(canonical_key(name));
+	std::size_t count = it == politicians_by_name.end() ? 0 : it->second.size();
+	timer.add_row(sizeof(std::int64_t));
+	return static_cast<std::int64_t>(exists ? std::min<std::size_t>(count, 1) : count);
+}
+
+std::int64_t memory_storage::count_politicians_by_party(const string& party, bool exists) const
+{
+	static query_counters counters("memory_storage::count_politicians_by_party");
+	query_timer timer(counters);
+
+	std::size_t party_id = find_party(canonical_key(party));
+	std::size_t count = party_id == parties.size() ? 0 : politicians_by_party[party_id].size();
+	timer.add_row(sizeof(std::int64_t));
+	return static_cast<std::int64_t>(exists ? std::min<std::size_t>(count, 1) : count);
+}
+
+std::int64_t memory_storage::count_ratings_in_range(const politician_core& p,
+		const rating_range& range, bool exists) const
+{
+	static query_counters counters("memory_storage::count_ratings_in_range");
+	query_timer timer(counters);
+
+	std::size_t count = 0;
+	std::int64_t id = find_politician(canonical_key(p.name), p.party);
+	if(id != 0)
+	{
+		const stored_politician& politician = politicians.at(id);
+		auto first = std::lower_bound(politician.ratings.begin(), politician.ratings.end(),
+				range.from, earlier);
+		auto last = std::lower_bound(first, politician.ratings.end(), range.to, earlier);
+		count = static_cast<std::size_t>(last - first);
+	}
+	if(exists)
+		count = std::min<std::size_t>(count, 1);
+	else if(range.limit != 0)
+		count = std::min(count, range.limit);
+	timer.add_row(sizeof(std::int64_t));
+	return static_cast<std::int64_t>(count);
+}
+
+std::int64_t memory_storage::count_all_ratings_in_range(const rating_range& range,
+		bool exists) const
+{
+	static query_counters counters("memory_storage::count_all_ratings_in_range");
+	query_timer timer(counters);
+
+	// The set can't count a range without walking it, so it stops at the limit
+	const std::size_t limit = exists ? 1 : range.limit;
+	auto first = ratings_by_date.lower_bound({range.from, 0});
+	auto last = ratings_by_date.lower_bound({range.to, 0});
+	std::size_t count = 0;
+	for(; first != last && (limit == 0 || count < limit); ++first)
+		++count;
+	timer.add_row(sizeof(std::int64_t));
+	return static_cast<std::int64_t>(count);
+}
+
+std::int64_t memory_storage::count_politicians(bool exists) const
+{
+	static query_counters counters("memory_storage::count_politicians");
+	query_timer timer(counters);
+
+	timer.add_row(sizeof(std::int64_t));
+	return static_cast<std::int64_t>(exists ? std::min<std::size_t>(politicians.size(), 1)
+			: politicians.size());
+}
+
+std::int64_t memory_storage::count_politicians_where(const filter_expression& filter,
+		bool exists) const
+{
+	static query_counters counters("memory_storage::count_politicians_where");
+	query_timer timer(counters);
+
+	std::int64_t count = 0;
+	for(const auto& entry : politicians)
+	{
+		if(matches(filter, entry.second) && ++count == 1 && exists)
+			break;
+	}
+	timer.add_row(sizeof(count));
+	return count;
+}
+
+std::int64_t memory_storage::count_politicians_batch(const vector<politician_core>& keys,
+		bool exists) const
+{
+	static query_counters counters("memory_storage::count_politicians_batch");
+	query_timer timer(counters);
+
+	std::int64_t count = 0;
+	for(std::size_t i = 0; i < keys.size() && !(exists && count > 0); ++i)
+		count += find_politician(canonical_key(keys[i].name), keys[i].party) != 0;
+	timer.add_row(sizeof(std::int64_t));
+	return count;
+}
+
+std::int64_t memory_storage::count_parties(bool exists) const
+{
+	static query_counters counters("memory_storage::count_parties");
+	query_timer timer(counters);
+
+	std::int64_t count = 0;
+	for(const vector<std::int64_t>& members : politicians_by_party)
+	{
+		if(!members.empty() && ++count == 1 && exists)
+			break;
+	}
+	timer.add_row(sizeof(count));
+	return count;
+}
+
+const vector<party_summary> memory_storage::get_party_leaderboard(const string& by,
+		const string& order) const
+{
+	const string function_name = "get_party_leaderboard";
+	static query_counters counters("memory_storage::get_party_leaderboard");
+	query_timer timer(counters);
+
+	if(order != "ASC" && order != "DESC")
+		throw std::domain_error(
+				"'order' parameter of function '" + function_name + "' not satisfed.\n"
+				"Expected: [DESC | ASC]. Got: " + order);
+	if(by != "total" && by != "avg" && by != "count")
+		throw std::domain_error(
+				"'by' parameter of function '" + function_name + "' not satisfed.\n"
+				"Expected: [total | avg | count]. Got: " + by);
+
+	vector<std::size_t> ids;
+	for(std::size_t id = 0; id < parties.size(); ++id)
+		if(!politicians_by_party[id].empty())
+			ids.push_back(id);
+
+	auto key = [this, &by](std::size_t id)
+	{
+		const double members = static_cast<double>(politicians_by_party[id].size());
+		const double total = static_cast<double>(party_totals[id]);
+		return by == "total" ? total : by == "avg" ? total / members : members;
+	};
+	const bool descending = order == "DESC";
+	std::sort(ids.begin(), ids.end(), [this, &key, descending](std::size_t a, std::size_t b)
+	{
+		double key_a = key(a), key_b = key(b);
+		if(key_a != key_b)
+			return descending ? key_a > key_b : key_a < key_b;
+		return parties[a].str() < parties[b].str();
+	});
+
+	vector<party_summary> result;
+	result.reserve(ids.size());
+	for(std::size_t id : ids)
+	{
+		timer.add_row(sizeof(party_handle) + 2 * sizeof(std::int64_t));
+		result.emplace_back(parties[id],
+				static_cast<std::int64_t>(politicians_by_party[id].size()), party_totals[id]);
+	}
+	return result;
+}
+
+rating_histogram memory_storage::get_politician_histogram(const politician_core& p) const
+{
+	static query_counters counters("memory_storage::get_politician_histogram");
+	query_timer timer(counters);
+
+	std::int64_t id = find_politician(canonical_key(p.name), p.party);
+	if(id == 0)
+		return rating_histogram();
+
+	timer.add_row(sizeof(rating_histogram));
+	return politicians.at(id).histogram;
+}
+
+rating_histogram memory_storage::get_party_histogram(const string& party) const
+{
+	static query_counters counters("memory_storage::get_party_histogram");
+	query_timer timer(counters);
+
+	std::size_t party_id = find_party(canonical_key(party));
+	if(party_id == parties.size())
+		return rating_histogram();
+
+	timer.add_row(sizeof(rating_histogram));
+	return party_histograms[party_id];
+}
+
+vector<politician_stats> memory_storage::get_politician_stats() const
+{
+	static query_counters counters("memory_storage::get_politician_stats");
+	query_timer timer(counters);
+
+	vector<std::int64_t> ids;
+	ids.reserve(politicians.size());
+	for(const auto& [id, p] : politicians)
+		ids.push_back(id);
+	std::sort(ids.begin(), ids.end());
+
+	vector<politician_stats> stats;
+	stats.reserve(ids.size());
+	for(std::int64_t id : ids)
+	{
+		const stored_politician& p = politicians.at(id);
+		std::int64_t negatives = 0;
+		for(short points = rating_histogram::min_points; points < 0; ++points)
+			negatives += p.histogram[points];
+
+		timer.add_row(p.name.size() + sizeof(party_handle) + 4 * sizeof(std::int64_t));
+		stats.push_back(politician_stats{p.name, parties[p.party_id], p.total_rating,
+				p.histogram.ratings(), negatives,
+				p.ratings.empty() ? 0 : p.ratings.back().date_time});
+	}
+	return stats;
+}
+
+void memory_storage::bulk_load(const std::function<void()>& load) const
+{
+	bulk_loading = true;
+	bulk_loaded.clear();
+	try
+	{
+		load();
+	}
+	catch(...)
+	{
+		// Undoes the ratings already loaded, newest first
+		for(auto it = bulk_loaded.rbegin(); it != bulk_loaded.rend(); ++it)
+			remove_rating(it->first, it->second);
+		// The undo is a change too, so the version still grows
+		++data_version;
+		bulk_loading = false;
+		bulk_loaded.clear();
+		throw;
+	}
+	bulk_loading = false;
+	bulk_loaded.clear();
+}
+
+void memory_storage::read_snapshot(const std::function<void(std::int64_t)>& read) const
+{
+	read(data_version);
+}
+
+verify_report memory_storage::verify_totals(unsigned, bool fix) const
+{
+	// Recounting every politician's ratings is cheap enough for a single thread
+	verify_report report{static_cast<std::int64_t>(politicians.size()),
+		static_cast<std::int64_t>(parties.size()), {}};
+	vector<std::int64_t> actual_party_totals(parties.size());
+	vector<rating_histogram> actual_party_histograms(parties.size());
+	for(auto& [id, p] : politicians)
+	{
+		rating_histogram actual;
+		for(const stored_rating& r : p.ratings)
+			++actual[r.points];
+		std::int64_t total = 0;
+		for(short points = rating_histogram::min_points; points <= rating_histogram::max_points;
+				++points)
+		{
+			total += points * actual[points];
+			actual_party_histograms[p.party_id][points] += actual[points];
+		}
+		actual_party_totals[p.party_id] += total;
+
+		if(total != p.total_rating)
+		{
+			report.drifts.push_back(aggregate_drift{id, static_cast<std::int64_t>(p.party_id),
+					p.name, parties[p.party_id].str(), "total_rating", 0, p.total_rating, total});
+		}
+		for(short points = rating_histogram::min_points; points <= rating_histogram::max_points;
+				++points)
+		{
+			if(actual[points] != p.histogram[points])
+			{
+				report.drifts.push_back(aggregate_drift{id, static_cast<std::int64_t>(p.party_id),
+						p.name, parties[p.party_id].str(), "histogram", points, p.histogram[points],
+						actual[points]});
+			}
+		}
+		if(fix)
+		{
+			p.total_rating = total;
+			p.histogram = actual;
+		}
+	}
+	// Keeps each politician's total before its histogram counts
+	std::stable_sort(report.drifts.begin(), report.drifts.end(),
+			[](const aggregate_drift& a, const aggregate_drift& b)
+	{
+		return a.politician_id < b.politician_id;
+	});
+
+	// Member counts are the sizes of politicians_by_party, which can't drift
+	for(std::size_t id = 0; id < parties.size(); ++id)
+	{
+		const std::int64_t party_id = static_cast<std::int64_t>(id);
+		if(party_totals[id] != actual_party_totals[id])
+		{
+			report.drifts.push_back(aggregate_drift{0, party_id, "", parties[id].str(),
+					"total_rating", 0, party_totals[id], actual_party_totals[id]});
+		}
+		for(short points = rating_histogram::min_points; points <= rating_histogram::max_points;
+				++points)
+		{
+			if(party_histograms[id][points] != actual_party_histograms[id][points])
+			{
+				report.drifts.push_back(aggregate_drift{0, party_id, "", parties[id].str(),
+						"histogram", points, party_histograms[id][points],
+						actual_party_histograms[id][points]});
+			}
+		}
+	}
+	if(fix)
+	{
+		party_totals = move(actual_party_totals);
+		party_histograms = move(actual_party_histograms);
+	}
+	return report;
+}
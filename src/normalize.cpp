@@ -0,0 +1,180 @@
+// Standard libraries
+#include <algorithm>
+#include <cstddef>
+
+// External libraries
+#include <boost/locale.hpp>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Local headers
+#include <normalize.hpp>
+#include <profile.hpp>
+
+using std::size_t;
+using std::string;
+using std::string_view;
+
+namespace
+{
+	bool is_ascii_byte(char c)
+	{
+		return static_cast<unsigned char>(c) < 0x80;
+	}
+
+	/**
+	 * Copies the bytes of 'in' to 'out' switching the case of the ASCII letters in
+	 * ['first', 'last'], until the first non-ASCII byte or 'size' bytes.
+	 * 'out' must have room for 'size' bytes, as whole blocks may be written past the
+	 * first non-ASCII byte.
+	 * @return the number of bytes converted
+	 */
+	size_t convert_ascii(const char* in, char* out, size_t size, char first, char last)
+	{
+		size_t i = 0;
+#ifdef __SSE2__
+		const __m128i before_first = _mm_set1_epi8(static_cast<char>(first - 1));
+		const __m128i after_last = _mm_set1_epi8(static_cast<char>(last + 1));
+		const __m128i case_bit = _mm_set1_epi8(0x20);
+
+		for(; i + 16 <= size; i += 16)
+		{
+			__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+			// Non-ASCII bytes are negative as signed chars, so they're never in range
+			__m128i in_range = _mm_and_si128(
+					_mm_cmpgt_epi8(block, before_first), _mm_cmplt_epi8(block, after_last));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+					_mm_xor_si128(block, _mm_and_si128(in_range, case_bit)));
+
+			int non_ascii = _mm_movemask_epi8(block);
+			if(non_ascii != 0)
+				return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(non_ascii)));
+		}
+#endif
+		for(; i < size; ++i)
+		{
+			char c = in[i];
+			if(!is_ascii_byte(c))
+				return i;
+			out[i] = (c >= first && c <= last) ? static_cast<char>(c ^ 0x20) : c;
+		}
+		return size;
+	}
+
+	/** Checks if 'c' belongs to one of the blocks of combining diacritical marks */
+	bool is_combining_mark(char32_t c)
+	{
+		return (c >= 0x0300 && c <= 0x036F) || (c >= 0x1AB0 && c <= 0x1AFF)
+			|| (c >= 0x1DC0 && c <= 0x1DFF) || (c >= 0x20D0 && c <= 0x20FF)
+			|| (c >= 0xFE20 && c <= 0xFE2F);
+	}
+
+	/**
+	 * The locale used to build canonical keys. Keys are stored in the database, so
+	 * unlike user_locale it must not depend on the user's environment.
+	 */
+	const std::locale& key_locale()
+	{
+		static const std::locale locale = []
+		{
+			boost::locale::generator gen;
+			return gen("en_US.UTF-8");
+		}();
+		return locale;
+	}
+}
+
+const std::locale& user_locale()
+{
+	// Generating the locale is expensive, so it's done once and only when needed
+	static const std::locale locale = []
+	{
+		startup_phase phase("locale");
+		boost::locale::generator gen;
+		return gen("");
+	}();
+	return locale;
+}
+
+bool is_ascii(string_view text)
+{
+	size_t i = 0;
+#ifdef __SSE2__
+	for(; i + 16 <= text.size(); i += 16)
+	{
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + i));
+		if(_mm_movemask_epi8(block) != 0)
+			return false;
+	}
+#endif
+	for(; i < text.size(); ++i)
+		if(!is_ascii_byte(text[i]))
+			return false;
+	return true;
+}
+
+string to_upper(string_view text)
+{
+	string result;
+	size_t in_pos = 0, out_pos = 0;
+
+	while(in_pos < text.size())
+	{
+		size_t remaining = text.size() - in_pos;
+		result.resize(out_pos + remaining);
+		size_t converted = convert_ascii(
+				text.data() + in_pos, &result[out_pos], remaining, 'a', 'z');
+		in_pos += converted;
+		out_pos += converted;
+
+		if(in_pos == text.size())
+			break;
+
+		// A run of non-ASCII bytes always holds whole UTF-8 sequences, since both
+		// their lead and continuation bytes are non-ASCII
+		size_t run_end = in_pos;
+		while(run_end < text.size() && !is_ascii_byte(text[run_end]))
+			++run_end;
+
+		string upper = boost::locale::to_upper(
+				text.data() + in_pos, text.data() + run_end, user_locale());
+		result.resize(out_pos);
+		result += upper;
+		out_pos += upper.size();
+		in_pos = run_end;
+	}
+
+	result.resize(out_pos);
+	return result;
+}
+
+string canonical_key(string_view text, bool strip_diacritics)
+{
+	using namespace boost::locale;
+
+	// Plain ASCII only needs folding to lowercase
+	if(is_ascii(text))
+	{
+		string key(text.size(), '\0');
+		convert_ascii(text.data(), &key[0], text.size(), 'A', 'Z');
+		return key;
+	}
+
+	const std::locale& locale = key_locale();
+	string key;
+	if(strip_diacritics)
+	{
+		// Decomposing first turns every accented letter into its base letter
+		// followed by combining marks, which are then dropped
+		std::u32string decomposed = conv::utf_to_utf<char32_t>(normalize(
+				text.data(), text.data() + text.size(), norm_nfd, locale));
+		decomposed.erase(std::remove_if(decomposed.begin(), decomposed.end(),
+				is_combining_mark), decomposed.end());
+		key = conv::utf_to_utf<char>(decomposed);
+	}
+	else
+		key = string(text);
+
+	return normalize(fold_case(key, locale), norm_nfc, locale);
+}
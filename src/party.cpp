@@ -0,0 +1,93 @@
+// Standard libraries
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// Local headers
+#include <party.hpp>
+#include <normalize.hpp>
+
+using std::string;
+using std::string_view;
+
+struct interned_party
+{
+	const string name;
+
+	// Built on first use, as reading a party back from the database doesn't need it
+	mutable string key;
+	mutable std::once_flag key_flag;
+
+	explicit interned_party(string_view name)
+		: name(name)
+	{}
+};
+
+namespace
+{
+	// Interned parties are never removed, which keeps every handle valid
+	std::unordered_map<string_view, std::unique_ptr<interned_party>> pool;
+	std::mutex pool_mutex;
+
+	const interned_party* intern(string_view name)
+	{
+		std::lock_guard<std::mutex> lock(pool_mutex);
+
+		auto it = pool.find(name);
+		if(it != pool.end())
+			return it->second.get();
+
+		auto entry = std::make_unique<interned_party>(name);
+		// The map key views the entry's own copy of the name
+		string_view key(entry->name);
+		return pool.emplace(key, std::move(entry)).first->second.get();
+	}
+}
+
+party_handle::party_handle(string_view name)
+	: entry(intern(name))
+{}
+
+party_handle::party_handle(const string& name)
+	: entry(intern(name))
+{}
+
+party_handle::party_handle(const char* name)
+	: entry(intern(name))
+{}
+
+const string& party_handle::str() const
+{
+	return entry->name;
+}
+
+const char* party_handle::c_str() const
+{
+	return entry->name.c_str();
+}
+
+const string& party_handle::key() const
+{
+	std::call_once(entry->key_flag, [this] { entry->key = canonical_key(entry->name); });
+	return entry->key;
+}
+
+party_handle::operator const string&() const
+{
+	return entry->name;
+}
+
+bool party_handle::operator==(const party_handle& other) const
+{
+	return entry == other.entry;
+}
+
+bool party_handle::operator!=(const party_handle& other) const
+{
+	return entry != other.entry;
+}
+
+std::ostream& operator<<(std::ostream& out, const party_handle& party)
+{
+	return out << party.str();
+}
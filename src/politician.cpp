@@ -1,31 +1,44 @@
 // Standard libraries
+#include <algorithm>
+#include <cstdio>
 #include <iostream>
 
 // Local headers
 #include <politician.hpp>
+#include <timestamp.hpp>
 
 using std::string;
 using std::move;
 
-politician_core::politician_core(string name, string party)
-	: name(move(name)), party(move(party))
+politician_core::politician_core(string name, party_handle party)
+	: name(move(name)), party(party)
 {}
 
-politician_update::politician_update(string name, string party, string new_party)
-	: politician_core(move(name), move(party)), new_party(move(new_party))
+politician_update::politician_update(string name, party_handle party, party_handle new_party)
+	: politician_core(move(name), party), new_party(new_party)
 {}
 
-politician::politician(string name, string party, string info, const short points)
-	: politician_core(move(name), move(party)), info(move(info)), points(points)
+politician::politician(string name, party_handle party, string info, const short points)
+	: politician_core(move(name), party), info(move(info)), points(points)
 {}
 
 rating::rating(
-		string name, string party, string description, const short points,
-		string date_time)
-	: politician_core(move(name), move(party)),
-		description(move(description)), points(points), date_time(move(date_time))
+		string name, party_handle party, string description, const short points,
+		std::int64_t date_time)
+	: politician_core(move(name), party),
+		description(move(description)), points(points), date_time(date_time)
 {}
 
+party_summary::party_summary(party_handle party, std::int64_t members,
+		std::int64_t total_rating)
+	: party(party), members(members), total_rating(total_rating)
+{}
+
+double party_summary::average() const
+{
+	return members > 0 ? static_cast<double>(total_rating) / static_cast<double>(members) : 0;
+}
+
 void politician_core::print_data() const
 {
 	std::cout << "Name: " << name << "\n"
@@ -45,12 +58,102 @@ void politician::print_data() const
 	             "Information: " << info << "\n";
 }
 
+void rating::print_line() const
+{
+	char signed_points[8];
+	std::snprintf(signed_points, sizeof(signed_points), "%+d", points);
+	std::cout << "  " << timestamp::format(date_time) << " | " << signed_points << " | "
+	          << description << "\n";
+}
+
+void projected_politician::print_data(const vector<politician_field>& fields) const
+{
+	for(politician_field field : fields)
+	{
+		switch(field)
+		{
+			case politician_field::name:
+				std::cout << "Name: " << name << "\n";
+				break;
+			case politician_field::party:
+				std::cout << "Party: " << *party << "\n";
+				break;
+			case politician_field::information:
+				std::cout << "Information: " << info << "\n";
+				break;
+			case politician_field::points:
+				std::cout << "Rating points: " << points << "\n";
+				break;
+			case politician_field::ratings:
+				std::cout << "Ratings: " << ratings << "\n";
+				break;
+		}
+	}
+}
+
 void rating::print_data() const
 {
 	politician_core::print_data();
 	std::cout << "Points: " << points << "\n";
-	if(date_time.empty() == false)
-		std::cout << "Date/time: " << date_time << "\n";
+	if(date_time != 0)
+		std::cout << "Date/time: " << timestamp::format(date_time) << "\n";
 	std::cout << "Description: " << description << "\n";
 }
 
+
+void party_summary::print_data() const
+{
+	char average_points[32];
+	std::snprintf(average_points, sizeof(average_points), "%.2f", average());
+	std::cout << "Party: " << party << "\n"
+	             "Members: " << members << "\n"
+	             "Total rating: " << total_rating << "\n"
+	             "Average rating: " << average_points << "\n";
+}
+
+std::int64_t& rating_histogram::operator[](short points)
+{
+	return counts[static_cast<std::size_t>(points - min_points)];
+}
+
+std::int64_t rating_histogram::operator[](short points) const
+{
+	return counts[static_cast<std::size_t>(points - min_points)];
+}
+
+std::int64_t rating_histogram::ratings() const
+{
+	std::int64_t ratings = 0;
+	for(std::int64_t count : counts)
+		ratings += count;
+	return ratings;
+}
+
+void rating_histogram::print_data() const
+{
+	const int bar_width = 40;
+	std::int64_t highest = 1;
+	for(std::int64_t count : counts)
+		highest = std::max(highest, count);
+
+	char label[8];
+	for(short points = min_points; points <= max_points; ++points)
+	{
+		const std::int64_t count = (*this)[points];
+		std::snprintf(label, sizeof(label), points == 0 ? "%3d | " : "%+3d | ", points);
+		std::cout << label << string(static_cast<std::size_t>(count * bar_width / highest), '#')
+		          << (count > 0 ? " " : "") << count << "\n";
+	}
+	std::cout << "Ratings: " << ratings() << "\n";
+}
+
+void rating_histogram::print_json(std::ostream& out) const
+{
+	out << "{\"ratings\": " << ratings() << ", \"counts\": {";
+	for(short points = min_points; points <= max_points; ++points)
+	{
+		out << (points > min_points ? ", " : "") << "\"" << points << "\": "
+		    << (*this)[points];
+	}
+	out << "}}\n";
+}
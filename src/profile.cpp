@@ -0,0 +1,71 @@
+// Standard libraries
+#include <array>
+#include <iomanip>
+
+// Local headers
+#include <profile.hpp>
+#include <trace.hpp>
+
+using std::chrono::steady_clock;
+
+namespace
+{
+	struct recorded_phase
+	{
+		const char* name;
+		steady_clock::time_point start;
+		steady_clock::time_point end;
+	};
+
+	// A command goes through a handful of phases, so a small fixed array suffices
+	std::array<recorded_phase, 32> phases;
+	std::size_t phase_count = 0;
+
+	steady_clock::time_point program_start = steady_clock::now();
+
+	double to_ms(steady_clock::duration duration)
+	{
+		return std::chrono::duration<double, std::milli>(duration).count();
+	}
+}
+
+startup_phase::startup_phase(const char* name)
+	: name(name), start(steady_clock::now())
+{}
+
+startup_phase::~startup_phase()
+{
+	auto end = steady_clock::now();
+	if(phase_count < phases.size())
+		phases[phase_count++] = {name, start, end};
+	if(trace::enabled)
+		trace::complete(name, start, end);
+}
+
+namespace startup_profile
+{
+	void start()
+	{
+		program_start = steady_clock::now();
+	}
+
+	void print(std::ostream& out)
+	{
+		auto flags = out.flags();
+		out << "Startup profile (milliseconds since the start of main):\n"
+		    << std::left << std::setw(16) << "  phase"
+		    << std::right << std::setw(12) << "start" << std::setw(12) << "duration" << "\n"
+		    << std::fixed << std::setprecision(3);
+
+		for(std::size_t i = 0; i < phase_count; ++i)
+		{
+			out << "  " << std::left << std::setw(14) << phases[i].name << std::right
+			    << std::setw(12) << to_ms(phases[i].start - program_start)
+			    << std::setw(12) << to_ms(phases[i].end - phases[i].start) << "\n";
+		}
+
+		out << "  " << std::left << std::setw(14) << "total" << std::right << std::setw(24)
+		    << to_ms(steady_clock::now() - program_start) << "\n";
+		out.flags(flags);
+	}
+}
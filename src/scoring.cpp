@@ -0,0 +1,160 @@
+// Standard libraries
+#include <algorithm>
+#include <limits>
+
+// External libraries
+#ifdef __SSE__
+#include <immintrin.h>
+#endif
+
+// Local headers
+#include <scoring.hpp>
+
+namespace
+{
+	constexpr float no_threshold = -std::numeric_limits<float>::infinity();
+
+	const double microseconds_per_day = 86400e6;
+
+	/** Whether 'a' ranks before 'b' */
+	bool better(const ranked_politician& a, const ranked_politician& b)
+	{
+		return a.score > b.score || (a.score == b.score && a.index < b.index);
+	}
+
+	/**
+	 * Keeps the best 'k' of the offered candidates in 'heap', whose front is the
+	 * worst of them.
+	 * @return the score a candidate must exceed to get in from now on
+	 */
+	float offer(vector<ranked_politician>& heap, std::size_t k, std::size_t index, float score)
+	{
+		const ranked_politician candidate{index, score};
+		if(heap.size() < k)
+		{
+			heap.push_back(candidate);
+			std::push_heap(heap.begin(), heap.end(), better);
+		}
+		else if(better(candidate, heap.front()))
+		{
+			std::pop_heap(heap.begin(), heap.end(), better);
+			heap.back() = candidate;
+			std::push_heap(heap.begin(), heap.end(), better);
+		}
+		// Candidates come by increasing index, so a tie never beats the worst one
+		return heap.size() < k ? no_threshold : heap.front().score;
+	}
+}
+
+feature_table::feature_table(const vector<politician_stats>& stats, std::int64_t now)
+{
+	politicians.reserve(stats.size());
+	total.reserve(stats.size());
+	mean.reserve(stats.size());
+	recency.reserve(stats.size());
+	negatives.reserve(stats.size());
+
+	for(const politician_stats& s : stats)
+	{
+		politicians.emplace_back(s.name, s.party);
+		const double ratings = static_cast<double>(s.ratings);
+		const double days = static_cast<double>(std::max<std::int64_t>(
+				now - s.latest_rating, 0)) / microseconds_per_day;
+
+		total.push_back(static_cast<float>(s.total_rating));
+		mean.push_back(s.ratings > 0
+				? static_cast<float>(static_cast<double>(s.total_rating) / ratings) : 0.0f);
+		recency.push_back(s.ratings > 0 ? static_cast<float>(1 / (1 + days)) : 0.0f);
+		negatives.push_back(static_cast<float>(s.negatives));
+	}
+}
+
+std::size_t feature_table::size() const
+{
+	return politicians.size();
+}
+
+vector<ranked_politician> top_k(const feature_table& features, const score_weights& weights,
+		std::size_t k)
+{
+	vector<ranked_politician> heap;
+	if(k == 0)
+		return heap;
+	heap.reserve(std::min(k, features.size()));
+
+	const std::size_t size = features.size();
+	const float* total = features.total.data();
+	const float* mean = features.mean.data();
+	const float* recency = features.recency.data();
+	const float* negatives = features.negatives.data();
+	float threshold = no_threshold;
+
+	std::size_t i = 0;
+#if defined(__AVX__)
+	const __m256 total_weight = _mm256_set1_ps(weights.total);
+	const __m256 mean_weight = _mm256_set1_ps(weights.mean);
+	const __m256 recency_weight = _mm256_set1_ps(weights.recency);
+	const __m256 negatives_weight = _mm256_set1_ps(weights.negatives);
+	alignas(32) float scores[8];
+
+	for(; i + 8 <= size; i += 8)
+	{
+		__m256 score = _mm256_mul_ps(_mm256_loadu_ps(total + i), total_weight);
+		score = _mm256_add_ps(score, _mm256_mul_ps(_mm256_loadu_ps(mean + i), mean_weight));
+		score = _mm256_add_ps(score, _mm256_mul_ps(_mm256_loadu_ps(recency + i), recency_weight));
+		score = _mm256_add_ps(score,
+				_mm256_mul_ps(_mm256_loadu_ps(negatives + i), negatives_weight));
+
+		unsigned above = static_cast<unsigned>(_mm256_movemask_ps(
+				_mm256_cmp_ps(score, _mm256_set1_ps(threshold), _CMP_GT_OQ)));
+		if(above == 0)
+			continue;
+
+		_mm256_store_ps(scores, score);
+		for(; above != 0; above &= above - 1)
+		{
+			unsigned lane = static_cast<unsigned>(__builtin_ctz(above));
+			threshold = offer(heap, k, i + lane, scores[lane]);
+		}
+	}
+#elif defined(__SSE__)
+	const __m128 total_weight = _mm_set1_ps(weights.total);
+	const __m128 mean_weight = _mm_set1_ps(weights.mean);
+	const __m128 recency_weight = _mm_set1_ps(weights.recency);
+	const __m128 negatives_weight = _mm_set1_ps(weights.negatives);
+	alignas(16) float scores[4];
+
+	for(; i + 4 <= size; i += 4)
+	{
+		__m128 score = _mm_mul_ps(_mm_loadu_ps(total + i), total_weight);
+		score = _mm_add_ps(score, _mm_mul_ps(_mm_loadu_ps(mean + i), mean_weight));
+		score = _mm_add_ps(score, _mm_mul_ps(_mm_loadu_ps(recency + i), recency_weight));
+		score = _mm_add_ps(score, _mm_mul_ps(_mm_loadu_ps(negatives + i), negatives_weight));
+
+		unsigned above = static_cast<unsigned>(
+				_mm_movemask_ps(_mm_cmpgt_ps(score, _mm_set1_ps(threshold))));
+		if(above == 0)
+			continue;
+
+		_mm_store_ps(scores, score);
+		for(; above != 0; above &= above - 1)
+		{
+			unsigned lane = static_cast<unsigned>(__builtin_ctz(above));
+			threshold = offer(heap, k, i + lane, scores[lane]);
+		}
+	}
+#endif
+	for(; i < size; ++i)
+	{
+		// The politicians left over after the last whole block
+		float score = total[i] * weights.total;
+		score += mean[i] * weights.mean;
+		score += recency[i] * weights.recency;
+		score += negatives[i] * weights.negatives;
+		if(score > threshold)
+			threshold = offer(heap, k, i, score);
+	}
+
+	std::sort_heap(heap.begin(), heap.end(), better);
+	return heap;
+}
@@ -0,0 +1,83 @@
+// Standard libraries
+#include <iomanip>
+#include <limits>
+
+// Local headers
+#include <stats.hpp>
+
+using std::uint64_t;
+using std::memory_order_relaxed;
+
+namespace
+{
+	// Head of the registry, a singly linked list of every operation's counters
+	std::atomic<query_counters*> registry(nullptr);
+
+	/** Stores 'value' in 'target' if 'better' says it should replace the current one */
+	template<class Compare>
+	void update_extreme(std::atomic<uint64_t>& target, uint64_t value, Compare better)
+	{
+		uint64_t current = target.load(memory_order_relaxed);
+		while(better(value, current)
+				&& !target.compare_exchange_weak(current, value, memory_order_relaxed))
+		{}
+	}
+}
+
+namespace query_stats
+{
+	bool enabled = false;
+
+	void enable()
+	{
+		enabled = true;
+	}
+
+	void print(std::ostream& out)
+	{
+		auto flags = out.flags();
+		out << "Query statistics:\n"
+		    << std::left << std::setw(28) << "  operation" << std::right
+		    << std::setw(8) << "calls" << std::setw(12) << "total ms"
+		    << std::setw(12) << "min us" << std::setw(12) << "mean us"
+		    << std::setw(12) << "max us" << std::setw(10) << "rows"
+		    << std::setw(12) << "bytes" << "\n"
+		    << std::fixed << std::setprecision(3);
+
+		for(query_counters* c = registry.load(); c != nullptr; c = c->next)
+		{
+			uint64_t calls = c->calls.load(memory_order_relaxed);
+			if(calls == 0)
+				continue;
+
+			double total_ns = static_cast<double>(c->total_ns.load(memory_order_relaxed));
+			out << "  " << std::left << std::setw(26) << c->name << std::right
+			    << std::setw(8) << calls
+			    << std::setw(12) << total_ns / 1e6
+			    << std::setw(12) << static_cast<double>(c->min_ns.load(memory_order_relaxed)) / 1e3
+			    << std::setw(12) << total_ns / static_cast<double>(calls) / 1e3
+			    << std::setw(12) << static_cast<double>(c->max_ns.load(memory_order_relaxed)) / 1e3
+			    << std::setw(10) << c->rows.load(memory_order_relaxed)
+			    << std::setw(12) << c->bytes.load(memory_order_relaxed) << "\n";
+		}
+		out.flags(flags);
+	}
+}
+
+query_counters::query_counters(const char* name)
+	: name(name), calls(0), total_ns(0), min_ns(std::numeric_limits<uint64_t>::max()),
+		max_ns(0), rows(0), bytes(0), next(registry.load())
+{
+	while(!registry.compare_exchange_weak(next, this))
+	{}
+}
+
+void query_counters::record(uint64_t ns, uint64_t rows, uint64_t bytes)
+{
+	calls.fetch_add(1, memory_order_relaxed);
+	total_ns.fetch_add(ns, memory_order_relaxed);
+	this->rows.fetch_add(rows, memory_order_relaxed);
+	this->bytes.fetch_add(bytes, memory_order_relaxed);
+	update_extreme(min_ns, ns, [](uint64_t a, uint64_t b) { return a < b; });
+	update_extreme(max_ns, ns, [](uint64_t a, uint64_t b) { return a > b; });
+}
@@ -0,0 +1,45 @@
+// Standard libraries
+#include <stdexcept>
+
+// Local headers
+#include <storage.hpp>
+#include <database.hpp>
+#include <memory_storage.hpp>
+#include <log_storage.hpp>
+#include <filesystem.hpp>
+
+using std::string;
+
+const vector<string>& leaderboard_orders()
+{
+	static const vector<string> orders = {"total", "avg", "count"};
+	return orders;
+}
+
+const vector<string>& politician_fields()
+{
+	static const vector<string> fields = {"name", "party", "information", "points", "ratings"};
+	return fields;
+}
+
+const vector<string>& storage_engines()
+{
+	static const vector<string> engines = {"sqlite", "memory", "log"};
+	return engines;
+}
+
+std::unique_ptr<storage> open_storage(const string& engine, const string& file)
+{
+	if(engine == "sqlite")
+	{
+		if(file.empty())
+			return std::make_unique<database>();
+		return std::make_unique<database>(file);
+	}
+	if(engine == "memory")
+		return std::make_unique<memory_storage>();
+	if(engine == "log")
+		return std::make_unique<log_storage>(file.empty() ? get_db_dir() + "log/" : file);
+
+	throw std::domain_error("Unknown storage engine '" + engine + "'");
+}
@@ -0,0 +1,135 @@
+// Standard libraries
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <stdexcept>
+
+// Local headers
+#include <timestamp.hpp>
+
+namespace
+{
+	constexpr std::int64_t micros_per_second = 1000000;
+
+	/** The last timestamp returned by timestamp::now() */
+	std::atomic<std::int64_t> last_now(0);
+
+	/** Floor division, so that times before the epoch split correctly */
+	std::int64_t floor_div(std::int64_t value, std::int64_t divisor)
+	{
+		std::int64_t quotient = value / divisor;
+		return quotient - (value % divisor < 0 ? 1 : 0);
+	}
+
+	/**
+	 * Parses the UTC offset "Z", "+HH:MM" or "-HH:MM" into 'seconds'.
+	 * @return whether 'offset' is one
+	 */
+	bool parse_offset(const string& offset, long& seconds)
+	{
+		if(offset == "Z")
+		{
+			seconds = 0;
+			return true;
+		}
+
+		if(offset.size() != 6 || (offset[0] != '+' && offset[0] != '-') || offset[3] != ':')
+			return false;
+		for(std::size_t i : {1u, 2u, 4u, 5u})
+			if(offset[i] < '0' || offset[i] > '9')
+				return false;
+
+		const long hours = (offset[1] - '0') * 10 + (offset[2] - '0');
+		const long minutes = (offset[4] - '0') * 10 + (offset[5] - '0');
+		if(hours > 23 || minutes > 59)
+			return false;
+		seconds = (offset[0] == '-' ? -1 : 1) * (hours * 3600 + minutes * 60);
+		return true;
+	}
+}
+
+namespace timestamp
+{
+	std::int64_t now()
+	{
+		const std::int64_t clock = std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::system_clock::now().time_since_epoch()).count();
+
+		std::int64_t last = last_now.load(std::memory_order_relaxed);
+		std::int64_t next;
+		do
+			next = clock > last ? clock : last + 1;
+		while(!last_now.compare_exchange_weak(last, next, std::memory_order_relaxed));
+
+		return next;
+	}
+
+	std::int64_t parse(const string& date_time)
+	{
+		std::tm local{};
+		char fraction[8] = "";
+		int date_size = 0, consumed = 0;
+		int fields = std::sscanf(date_time.c_str(), "%4d-%2d-%2d%n %2d:%2d:%2d%n.%7[0-9]%n",
+				&local.tm_year, &local.tm_mon, &local.tm_mday, &date_size,
+				&local.tm_hour, &local.tm_min, &local.tm_sec, &consumed, fraction, &consumed);
+		// A date alone is its midnight
+		const bool date_only = fields == 3
+			&& static_cast<std::size_t>(date_size) == date_time.size();
+		long offset = 0;
+		const bool has_offset = !date_only && fields >= 6
+			&& static_cast<std::size_t>(consumed) != date_time.size()
+			&& parse_offset(date_time.substr(static_cast<std::size_t>(consumed)), offset);
+		if(!date_only && (fields < 6 || string(fraction).size() > 6
+				|| (static_cast<std::size_t>(consumed) != date_time.size() && !has_offset)))
+			throw std::domain_error("Invalid date/time '" + date_time + "'.\n"
+					"Expected: YYYY-MM-DD[ HH:MM:SS[.ffffff][Z|+HH:MM|-HH:MM]]");
+
+		local.tm_year -= 1900;
+		local.tm_mon -= 1;
+		// Lets mktime find out whether daylight saving time applies, unless the
+		// offset already tells
+		local.tm_isdst = -1;
+		std::tm normalized = local;
+		// -1 is also the second before the epoch, so a failure is told by the day of
+		// the week, which is only set on success
+		normalized.tm_wday = -1;
+		std::time_t seconds = has_offset ? timegm(&normalized) - offset
+			: std::mktime(&normalized);
+		if(normalized.tm_wday < 0 || normalized.tm_mday != local.tm_mday
+				|| normalized.tm_mon != local.tm_mon)
+			throw std::domain_error("Invalid date/time '" + date_time + "'.");
+
+		std::int64_t micros = 0;
+		int digits = 0;
+		for(const char* digit = fraction; *digit; ++digit, ++digits)
+			micros = micros * 10 + (*digit - '0');
+		for(; digits < 6; ++digits)
+			micros *= 10;
+
+		return static_cast<std::int64_t>(seconds) * micros_per_second + micros;
+	}
+
+	string format(std::int64_t time, bool with_offset)
+	{
+		const std::time_t seconds = static_cast<std::time_t>(floor_div(time, micros_per_second));
+		const long micros = static_cast<long>(time - static_cast<std::int64_t>(seconds)
+				* micros_per_second);
+
+		std::tm local;
+		localtime_r(&seconds, &local);
+		char buffer[40];
+		std::size_t size = std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &local);
+		if(micros != 0)
+			size += static_cast<std::size_t>(
+					std::snprintf(buffer + size, sizeof(buffer) - size, ".%06ld", micros));
+		if(with_offset)
+		{
+			// strftime has no colon between the hours and minutes of the offset
+			char offset[8];
+			std::strftime(offset, sizeof(offset), "%z", &local);
+			std::snprintf(buffer + size, sizeof(buffer) - size, "%.3s:%s", offset, offset + 3);
+		}
+		return buffer;
+	}
+}
@@ -0,0 +1,117 @@
+// Standard libraries
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+
+// Local headers
+#include <trace.hpp>
+
+using std::memory_order_acquire;
+using std::memory_order_relaxed;
+using std::memory_order_release;
+
+namespace
+{
+	struct trace_event
+	{
+		const char* name;
+		trace::clock::time_point start;
+		trace::clock::time_point end;
+	};
+
+	/**
+	 * Events recorded by a single thread. Only the owning thread writes to it,
+	 * overwriting the oldest events once it's full, so no locking is needed.
+	 */
+	struct trace_buffer
+	{
+		static const std::size_t capacity = 1 << 14;
+
+		std::array<trace_event, capacity> events;
+		// Number of events ever recorded, the next one goes to head % capacity
+		std::atomic<std::size_t> head;
+		const unsigned thread_id;
+		trace_buffer* next;
+
+		trace_buffer(unsigned thread_id, trace_buffer* next)
+			: head(0), thread_id(thread_id), next(next)
+		{}
+	};
+
+	// Every thread's buffer. Buffers are never freed, since their threads may
+	// have finished before the trace is written.
+	std::atomic<trace_buffer*> buffers(nullptr);
+	std::atomic<unsigned> thread_count(0);
+
+	thread_local trace_buffer* local_buffer = nullptr;
+
+	// Every timestamp is reported relative to the start of the program
+	const trace::clock::time_point origin = trace::clock::now();
+
+	trace_buffer* create_buffer()
+	{
+		auto buffer = new trace_buffer(thread_count.fetch_add(1) + 1, buffers.load());
+		while(!buffers.compare_exchange_weak(buffer->next, buffer))
+		{}
+		return buffer;
+	}
+
+	double to_us(trace::clock::duration duration)
+	{
+		return std::chrono::duration<double, std::micro>(duration).count();
+	}
+}
+
+namespace trace
+{
+	bool enabled = false;
+
+	void enable()
+	{
+		enabled = true;
+	}
+
+	void complete(const char* name, clock::time_point start, clock::time_point end)
+	{
+		if(local_buffer == nullptr)
+			local_buffer = create_buffer();
+
+		std::size_t head = local_buffer->head.load(memory_order_relaxed);
+		local_buffer->events[head % trace_buffer::capacity] = {name, start, end};
+		local_buffer->head.store(head + 1, memory_order_release);
+	}
+
+	void write(const string& file)
+	{
+		std::ofstream out(file);
+		if(!out)
+			throw std::runtime_error("Could not open the trace file '" + file + "'");
+
+		out << std::fixed << std::setprecision(3)
+		    << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+
+		bool first = true;
+		for(trace_buffer* buffer = buffers.load(); buffer != nullptr; buffer = buffer->next)
+		{
+			std::size_t head = buffer->head.load(memory_order_acquire);
+			std::size_t begin = head > trace_buffer::capacity ? head - trace_buffer::capacity : 0;
+
+			out << (first ? "" : ",")
+			    << "\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+			    << buffer->thread_id << ", \"args\": {\"name\": \"thread "
+			    << buffer->thread_id << "\"}}";
+			first = false;
+
+			for(std::size_t i = begin; i < head; ++i)
+			{
+				const trace_event& e = buffer->events[i % trace_buffer::capacity];
+				out << ",\n{\"name\": \"" << e.name << "\", \"cat\": \"politician\", \"ph\": \"X\""
+				    << ", \"ts\": " << to_us(e.start - origin)
+				    << ", \"dur\": " << to_us(e.end - e.start)
+				    << ", \"pid\": 1, \"tid\": " << buffer->thread_id << "}";
+			}
+		}
+		out << "\n]}\n";
+	}
+}
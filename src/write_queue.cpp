@@ -0,0 +1,176 @@
+// Standard libraries
+#include <algorithm>
+
+// Local headers
+#include <write_queue.hpp>
+#include <trace.hpp>
+
+using std::move;
+
+write_queue::write_queue(const database& db, std::size_t max_batch,
+		std::chrono::microseconds max_delay)
+	: db(db), max_batch(std::max<std::size_t>(max_batch, 1)), max_delay(max_delay),
+		head(new node{{nullptr}, {}, {}}), tail(head.load()), sleeping(false),
+		stopping(false)
+{
+	writer = std::thread(&write_queue::run, this);
+}
+
+write_queue::~write_queue()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		stopping = true;
+	}
+	wake_up.notify_one();
+	writer.join();
+	delete tail;
+}
+
+std::future<int> write_queue::submit(operation op)
+{
+	node* n = new node{{nullptr}, move(op), {}};
+	std::future<int> future = n->result.get_future();
+
+	node* previous = head.exchange(n, std::memory_order_acq_rel);
+	previous->next.store(n, std::memory_order_release);
+
+	// Pairs with the fence in wait_pop: either the writer sees the new node, or
+	// this thread sees it sleeping
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if(sleeping.load())
+	{
+		// Taking the lock makes sure the writer is either still checking the queue
+		// or already waiting, not in between
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		wake_up.notify_one();
+	}
+	return future;
+}
+
+std::future<int> write_queue::insert_to_politician(politician p)
+{
+	return submit([p = move(p)](const database& db) { return db.insert_to_politician(p); });
+}
+
+std::future<int> write_queue::insert_to_ratings(rating r)
+{
+	return submit([r = move(r)](const database& db) { return db.insert_to_ratings(r); });
+}
+
+std::future<int> write_queue::update_party(politician_update p)
+{
+	return submit([p = move(p)](const database& db) { return db.update_party(p); });
+}
+
+std::future<int> write_queue::delete_politician(politician_core p)
+{
+	return submit([p = move(p)](const database& db) { return db.delete_politician(p); });
+}
+
+bool write_queue::pop(request& out)
+{
+	node* next = tail->next.load(std::memory_order_acquire);
+	if(next == nullptr)
+		return false;
+
+	// 'next' becomes the new (consumed) tail, so its contents are moved out
+	out.op = move(next->op);
+	out.result = move(next->result);
+	delete tail;
+	tail = next;
+	return true;
+}
+
+bool write_queue::wait_pop(request& out)
+{
+	if(pop(out))
+		return true;
+
+	std::unique_lock<std::mutex> lock(sleep_mutex);
+	sleeping = true;
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	// A producer that missed 'sleeping' has already linked its node, which pop sees
+	wake_up.wait(lock, [this, &out] { return pop(out) || stopping; });
+	sleeping = false;
+	// The queue is drained before stopping
+	return out.op || pop(out);
+}
+
+void write_queue::run()
+{
+	vector<request> batch;
+	batch.reserve(max_batch);
+
+	request next;
+	while(wait_pop(next))
+	{
+		const auto deadline = std::chrono::steady_clock::now() + max_delay;
+		batch.push_back(move(next));
+		next = request();
+
+		while(batch.size() < max_batch)
+		{
+			if(pop(next))
+			{
+				batch.push_back(move(next));
+				next = request();
+			}
+			else if(std::chrono::steady_clock::now() < deadline)
+				std::this_thread::yield();
+			else
+				break;
+		}
+
+		commit_batch(batch);
+		batch.clear();
+	}
+}
+
+void write_queue::commit_batch(vector<request>& batch)
+{
+	trace_span span("write batch");
+
+	vector<int> results(batch.size(), 0);
+	vector<std::exception_ptr> errors(batch.size());
+
+	try
+	{
+		db_transaction transaction(db, "BEGIN IMMEDIATE;");
+		for(std::size_t i = 0; i < batch.size(); ++i)
+		{
+			try
+			{
+				results[i] = batch[i].op(db);
+			}
+			catch(...)
+			{
+				errors[i] = std::current_exception();
+				// Some errors roll the whole transaction back, taking the writes
+				// already applied with it
+				if(sqlite3_get_autocommit(db.connection))
+				{
+					transaction.open = false;
+					throw;
+				}
+			}
+		}
+		transaction.commit();
+	}
+	catch(...)
+	{
+		std::exception_ptr error = std::current_exception();
+		for(std::exception_ptr& e : errors)
+			if(!e)
+				e = error;
+	}
+
+	// Writes are only acknowledged once their transaction is over
+	for(std::size_t i = 0; i < batch.size(); ++i)
+	{
+		if(errors[i])
+			batch[i].result.set_exception(errors[i]);
+		else
+			batch[i].result.set_value(results[i]);
+	}
+}